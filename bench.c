@@ -0,0 +1,395 @@
+#if defined(TJSON_READ_ASYNC)
+#define _XOPEN_SOURCE 600
+#endif
+#define TJSON_IMPLEMENTATION
+#include "tinyjson.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(TJSON_READ_ASYNC)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(TJSON_NO_POOL)
+#define BENCH_ALLOCATOR "malloc"
+#define BENCH_NODE_SIZE sizeof(tjson_t)
+#else
+#define BENCH_ALLOCATOR "pool"
+#define BENCH_NODE_SIZE sizeof(tjson_pool_block_t)
+#endif
+
+static long allocs = 0;
+static long node_allocs = 0;
+static size_t alloc_bytes = 0;
+
+/* node (or node block) requests are told apart by their size, everything
+ * else is a name, string or number buffer */
+static void* count_malloc(size_t size) {
+  allocs++;
+  node_allocs += size == BENCH_NODE_SIZE;
+  alloc_bytes += size;
+  return malloc(size);
+}
+static void* count_realloc(void* ptr, size_t size) { allocs++; alloc_bytes += size; return realloc(ptr, size); }
+
+static double elapsed_ns(clock_t start) {
+  return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC;
+}
+
+/* Builds a small game-state like tree and tears it down, the way a server
+ * tick does. Returns the number of nodes created, the positions are packed
+ * so their numbers aren't nodes. */
+static long churn(int rounds, int entities) {
+  long nodes = 0;
+  int r, i;
+  for (r = 0; r < rounds; r++) {
+    tjson_t *state = tjson_create_object();
+    tjson_t *list = tjson_create_array();
+    nodes += 2;
+    for (i = 0; i < entities; i++) {
+      tjson_t *entity = tjson_create_object();
+      tjson_t *position = tjson_create_array();
+      tjson_object_set_string(entity, "name", "Player");
+      tjson_object_set_number(entity, "life", 10);
+      tjson_array_push_number(position, i);
+      tjson_array_push_number(position, r);
+      tjson_object_set_array(entity, "position", position);
+      tjson_array_push_object(list, entity);
+      nodes += 4;
+    }
+    tjson_object_set_array(state, "entities", list);
+    tjson_delete(state);
+  }
+  return nodes;
+}
+
+static void bench_churn(int rounds, int entities) {
+  clock_t start;
+  long nodes;
+  double ns;
+
+  churn(1, entities);
+  allocs = node_allocs = 0;
+  start = clock();
+  nodes = churn(rounds, entities);
+  ns = elapsed_ns(start);
+  printf("churn[%s]: %ld nodes, %.1f ns/node, %ld node allocator calls, %ld name/string/array allocator calls\n",
+         BENCH_ALLOCATOR, nodes, ns / nodes, node_allocs, allocs - node_allocs);
+}
+
+/* A wide log record where only a few columns are wanted */
+static char *make_record(int fields) {
+  size_t cap = (size_t)fields * 96 + 64, len = 0;
+  char *buf = malloc(cap);
+  int i;
+  len += sprintf(buf + len, "{");
+  for (i = 0; i < fields; i++) {
+    if (i % 3 == 0)
+      len += sprintf(buf + len, "\"field%d\": \"some value for field %d\",", i, i);
+    else if (i % 3 == 1)
+      len += sprintf(buf + len, "\"field%d\": [%d, %d, %d, {\"inner\": %d}],", i, i, i + 1, i + 2, i);
+    else
+      len += sprintf(buf + len, "\"field%d\": {\"x\": %d, \"y\": %d.5},", i, i, i);
+  }
+  buf[len - 1] = '}';
+  return buf;
+}
+
+static void bench_extract(int rounds, int fields) {
+  const char *columns[] = {"/field0", "/field4", "/field10/x", "/field22/y", "/field31",
+                           "/field40/3/inner", "/field60", "/field99/x", "/field120", "/field150/0"};
+  int ncols = sizeof(columns) / sizeof(columns[0]);
+  tjson_path_t *paths[16];
+  tjson_t *out[16];
+  char *record = make_record(fields);
+  size_t bytes = strlen(record);
+  clock_t start;
+  double ns;
+  int r, i;
+
+  for (i = 0; i < ncols; i++) paths[i] = tjson_path_compile(columns[i]);
+
+  start = clock();
+  for (r = 0; r < rounds; r++) {
+    tjson_t *json = tjson_parse(record);
+    for (i = 0; i < ncols; i++) out[i] = tjson_path_get(paths[i], json);
+    tjson_delete(json);
+  }
+  ns = elapsed_ns(start) / rounds;
+  printf("parse+lookup: %.1f ns/record, %.1f MB/s\n", ns, bytes * 1e3 / ns);
+
+  start = clock();
+  for (r = 0; r < rounds; r++) {
+    tjson_extract(record, paths, ncols, out);
+    for (i = 0; i < ncols; i++) tjson_delete(out[i]);
+  }
+  ns = elapsed_ns(start) / rounds;
+  printf("extract: %.1f ns/record, %.1f MB/s\n", ns, bytes * 1e3 / ns);
+
+  for (i = 0; i < ncols; i++) tjson_path_free(paths[i]);
+  free(record);
+}
+
+/* tileset.json like asset: a header, a tile index array and tile objects */
+static char *make_asset(int tiles) {
+  size_t cap = (size_t)tiles * 160 + 256, len = 0;
+  char *buf = malloc(cap);
+  int i;
+  len += sprintf(buf + len, "{\"__header__\": {\"type\": \"tileset\", \"name\": \"forest\"}, \"bitmasks\": [");
+  for (i = 0; i < tiles; i++) len += sprintf(buf + len, "%d%s", (i * 37) % 256, i + 1 < tiles ? ", " : "");
+  len += sprintf(buf + len, "], \"tiles\": [");
+  for (i = 0; i < tiles; i++) {
+    len += sprintf(buf + len, "{\"id\": %d, \"image\": \"tiles/grass\", \"solid\": %s, \"uv\": [%d, %d, 16, 16]}%s",
+                   i, i % 2 ? "true" : "false", i % 8, i / 8, i + 1 < tiles ? ", " : "");
+  }
+  len += sprintf(buf + len, "]}");
+  return buf;
+}
+
+static void bench_binary(int rounds, int tiles) {
+  char *text = make_asset(tiles);
+  size_t text_size = strlen(text), binary_size = 0;
+  tjson_t *json = tjson_parse(text);
+  void *binary = tjson_encode(json, &binary_size);
+  clock_t start;
+  double ns, sum = 0;
+  int r;
+
+  tjson_delete(json);
+  printf("asset: %lu bytes text, %lu bytes binary\n", (unsigned long)text_size, (unsigned long)binary_size);
+
+  start = clock();
+  for (r = 0; r < rounds; r++) tjson_delete(tjson_parse(text));
+  ns = elapsed_ns(start) / rounds;
+  printf("text parse: %.1f us/load, %.1f MB/s\n", ns / 1e3, text_size * 1e3 / ns);
+
+  start = clock();
+  for (r = 0; r < rounds; r++) tjson_delete(tjson_decode(binary, binary_size));
+  ns = elapsed_ns(start) / rounds;
+  printf("binary load: %.1f us/load, %.1f MB/s\n", ns / 1e3, binary_size * 1e3 / ns);
+
+  /* read every tile id in place, without building the tree */
+  start = clock();
+  for (r = 0; r < rounds; r++) {
+    tjson_view_t root, tiles, tile, id;
+    if (tjson_view_open(&root, binary, binary_size) || !tjson_view_get(&root, "tiles", &tiles)) break;
+    if (tjson_view_child(&tiles, &tile)) {
+      do {
+        if (tjson_view_get(&tile, "id", &id)) sum += tjson_view_number(&id);
+      } while (tjson_view_next(&tile));
+    }
+  }
+  ns = elapsed_ns(start) / rounds;
+  printf("binary view: %.1f us/walk (sum %.0f)\n", ns / 1e3, sum);
+
+  tjson_free(binary);
+  free(text);
+}
+
+static void bench_numbers(int count) {
+  char *text = malloc((size_t)count * 8 + 8);
+  size_t len = 0;
+  tjson_t *json;
+  double *numbers, sum = 0;
+  clock_t start;
+  int i, n;
+
+  len += sprintf(text, "[");
+  for (i = 0; i < count; i++) len += sprintf(text + len, "%d,", i % 1000);
+  text[len - 1] = ']';
+
+  alloc_bytes = 0;
+  start = clock();
+  json = tjson_parse(text);
+  printf("numbers: %d parsed in %.1f us, %lu bytes allocated",
+         count, elapsed_ns(start) / 1e3, (unsigned long)alloc_bytes);
+  start = clock();
+  numbers = tjson_array_numbers(json, &n);
+  for (i = 0; i < n; i++) sum += numbers[i];
+  printf(", summed in %.1f us (%g)\n", elapsed_ns(start) / 1e3, sum);
+
+  tjson_delete(json);
+  free(text);
+}
+
+static void bench_reparse(int rounds) {
+  const char *bodies[2] = {
+    "{\"user\": \"player-one\", \"action\": \"move\", \"position\": [10.5, 20.25], \"inventory\": [\"sword\", \"shield\"], \"stats\": {\"life\": 10, \"speed\": 95.55}}",
+    "{\"user\": \"player-two\", \"action\": \"jump\", \"position\": [11.5, 19.75], \"inventory\": [\"bow\", \"arrow\"], \"stats\": {\"life\": 9, \"speed\": 90.5}}"
+  };
+  tjson_t *json = NULL;
+  clock_t start;
+  double ns;
+  int r;
+
+  allocs = 0;
+  start = clock();
+  for (r = 0; r < rounds; r++) tjson_delete(tjson_parse(bodies[r & 1]));
+  ns = elapsed_ns(start) / rounds;
+  printf("parse+delete: %.1f ns/request, %.1f allocator calls/request\n", ns, (double)allocs / rounds);
+
+  json = tjson_parse(bodies[0]);
+  allocs = 0;
+  start = clock();
+  for (r = 0; r < rounds; r++) json = tjson_reparse(json, bodies[r & 1]);
+  ns = elapsed_ns(start) / rounds;
+  printf("reparse: %.1f ns/request, %.1f allocator calls/request\n", ns, (double)allocs / rounds);
+  tjson_delete(json);
+}
+
+static void bench_compare(int rounds, int tiles) {
+  char *text = make_asset(tiles);
+  tjson_t *json = tjson_parse(text);
+  tjson_t *copy;
+  clock_t start;
+  unsigned int hash = 0;
+  int r, equal = 0;
+
+  start = clock();
+  for (r = 0; r < rounds; r++) tjson_delete(tjson_parse(text));
+  printf("copy by parse: %.1f us\n", elapsed_ns(start) / rounds / 1e3);
+
+  start = clock();
+  for (r = 0; r < rounds; r++) tjson_delete(tjson_clone(json));
+  printf("clone: %.1f us\n", elapsed_ns(start) / rounds / 1e3);
+
+  start = clock();
+  for (r = 0; r < rounds; r++) hash += tjson_hash(json);
+  printf("hash: %.1f us (%08x)\n", elapsed_ns(start) / rounds / 1e3, hash);
+
+  copy = tjson_clone(json);
+  start = clock();
+  for (r = 0; r < rounds; r++) equal += tjson_equal(json, copy);
+  printf("equal: %.1f us (%d)\n", elapsed_ns(start) / rounds / 1e3, equal == rounds);
+
+  tjson_delete(copy);
+  tjson_delete(json);
+  free(text);
+}
+
+static void bench_patch(int rounds, int tiles) {
+  char *text = make_asset(tiles);
+  tjson_t *from = tjson_parse(text);
+  tjson_t *to = tjson_clone(from);
+  tjson_t *header = tjson_object_get(to, "__header__");
+  tjson_t *patch, *json;
+  clock_t start;
+  int r;
+
+  tjson_object_set_string(header, "name", "desert");
+  tjson_object_set_number(header, "version", 2);
+  patch = tjson_merge_diff(from, to);
+
+  start = clock();
+  for (r = 0; r < rounds; r++) tjson_delete(tjson_parse(text));
+  printf("rebuild: %.1f us\n", elapsed_ns(start) / rounds / 1e3);
+
+  json = tjson_clone(from);
+  start = clock();
+  for (r = 0; r < rounds; r++) json = tjson_merge_patch(json, patch);
+  printf("merge patch: %.1f us (%d)\n", elapsed_ns(start) / rounds / 1e3, tjson_equal(json, to));
+
+  tjson_delete(json);
+  tjson_delete(patch);
+  tjson_delete(to);
+  tjson_delete(from);
+  free(text);
+}
+
+static void bench_cache(int rounds, int tiles) {
+  const char *path = "bench_cache.json";
+  char *text = make_asset(tiles);
+  FILE *fp = fopen(path, "wb");
+  tjson_cache_t *cache = tjson_cache_create(64 << 20);
+  unsigned long hits = 0, misses = 0;
+  clock_t start;
+  int r;
+
+  fputs(text, fp);
+  fclose(fp);
+
+  start = clock();
+  for (r = 0; r < rounds; r++) tjson_delete(tjson_open(path));
+  printf("open: %.1f us\n", elapsed_ns(start) / rounds / 1e3);
+
+  start = clock();
+  for (r = 0; r < rounds; r++) tjson_shared_release(tjson_cache_open(cache, path));
+  tjson_cache_stats(cache, &hits, &misses, NULL);
+  printf("cache open: %.1f us (%lu hits, %lu misses)\n", elapsed_ns(start) / rounds / 1e3, hits, misses);
+
+  tjson_cache_destroy(cache);
+  remove(path);
+  free(text);
+}
+
+#if defined(TJSON_READ_ASYNC)
+/* wall time, waiting on the disk doesn't show in clock() */
+static double wall_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* drops the file from the page cache, so the next read goes to the disk */
+static void evict(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return;
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+static void bench_read(int rounds, int tiles) {
+  const char *path = "bench_read.json";
+  char *text = make_asset(tiles);
+  size_t size = strlen(text);
+  FILE *fp = fopen(path, "wb");
+  double start, read_ns = 0, whole_ns = 0, stream_ns = 0;
+  int r;
+
+  fputs(text, fp);
+  fclose(fp);
+  free(text);
+
+  for (r = 0; r < rounds; r++) {
+    char *source;
+    evict(path);
+    start = wall_ns();
+    source = s_file_read(path);
+    read_ns += wall_ns() - start;
+    tjson_delete(tjson_parse(source));
+    whole_ns += wall_ns() - start;
+    s_free(source);
+
+    evict(path);
+    start = wall_ns();
+    tjson_delete(tjson_open(path));
+    stream_ns += wall_ns() - start;
+  }
+  printf("cold read: %.1f MB, read %.1f ms, read then parse %.1f ms, streamed open %.1f ms\n",
+         size / 1e6, read_ns / rounds / 1e6, whole_ns / rounds / 1e6, stream_ns / rounds / 1e6);
+  remove(path);
+}
+#endif
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 2000;
+  tjson_set_allocator(count_malloc, count_realloc, NULL);
+  bench_churn(rounds, 256);
+  bench_extract(rounds * 5, 200);
+  bench_binary(rounds / 20 + 1, 2000);
+  bench_numbers(200000);
+  bench_reparse(rounds * 50);
+  bench_compare(rounds / 20 + 1, 2000);
+  bench_patch(rounds, 2000);
+  bench_cache(rounds / 20 + 1, 2000);
+#if defined(TJSON_READ_ASYNC)
+  bench_read(5, 200000);
+#endif
+  tjson_pool_free();
+  return 0;
+}
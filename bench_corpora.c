@@ -0,0 +1,465 @@
+#define _XOPEN_SOURCE 600
+#define TJSON_IMPLEMENTATION
+#include "tinyjson.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define BENCH_FORK 1
+#endif
+
+#if defined(TJSON_NO_POOL)
+#define BENCH_ALLOCATOR "malloc"
+#else
+#define BENCH_ALLOCATOR "pool"
+#endif
+
+/* Parse, lookup, iteration, serialize and delete over generated corpora,
+ * plus any json files given on the command line. Every measurement is one
+ * json object per line on stdout:
+ *
+ * {"corpus":"canada","allocator":"pool","op":"parse","bytes":..,"rounds":..,
+ *  "ns_op":..,"mb_s":..,"allocs":..,"alloc_bytes":..,"peak_rss_kb":..}
+ *
+ * 'mb_s' is null for lookups, 'peak_rss_kb' is the peak of the process
+ * running the corpus (each one runs in its own when fork is available).
+ * Built with TJSON_STATS it adds an "op":"stats" line with the parse
+ * instrumentation counters. */
+
+#define BENCH_MIN_NS 2.5e8
+
+static long allocs = 0;
+static size_t alloc_bytes = 0;
+
+static void* count_malloc(size_t size) { allocs++; alloc_bytes += size; return malloc(size); }
+static void* count_realloc(void* ptr, size_t size) { allocs++; alloc_bytes += size; return realloc(ptr, size); }
+
+static double elapsed_ns(clock_t start) {
+  return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC;
+}
+
+/*=================*
+ *    Generators   *
+ *=================*/
+
+typedef struct {
+  char *data;
+  size_t len, cap;
+} text_t;
+
+/* every single put stays well under 1k */
+static void put(text_t *t, const char *fmt, ...) {
+  va_list args;
+  if (t->len + 1024 > t->cap) {
+    t->cap = t->cap ? t->cap * 2 : 1 << 16;
+    t->data = realloc(t->data, t->cap);
+  }
+  va_start(args, fmt);
+  t->len += vsprintf(t->data + t->len, fmt, args);
+  va_end(args);
+}
+
+static unsigned int seed = 12345;
+
+static unsigned int rnd(unsigned int n) {
+  seed = seed * 1103515245u + 12345u;
+  return (seed >> 8) % n;
+}
+
+static double rnd_float(double lo, double hi) {
+  return lo + (hi - lo) * rnd(1000000) / 1000000.0 + rnd(1000) * 1e-9;
+}
+
+static const char *words[] = {"lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit",
+                              "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore", "magna"};
+
+static void put_words(text_t *t, int count) {
+  int i;
+  for (i = 0; i < count; i++) put(t, "%s%s", i ? " " : "", words[rnd(16)]);
+}
+
+/* one big all-number array, integers and floats */
+static char *gen_numbers(void) {
+  text_t t = {0};
+  int i;
+  put(&t, "[");
+  for (i = 0; i < 150000; i++) {
+    if (i % 2) put(&t, "%s%d", i ? "," : "", (int)rnd(100000) - 50000);
+    else put(&t, "%s%.6f", i ? "," : "", rnd_float(-1000, 1000));
+  }
+  put(&t, "]");
+  return t.data;
+}
+
+/* mostly text, with escape sequences */
+static char *gen_strings(void) {
+  text_t t = {0};
+  int i;
+  put(&t, "[");
+  for (i = 0; i < 20000; i++) {
+    put(&t, "%s\"", i ? "," : "");
+    put_words(&t, 2 + rnd(20));
+    if (rnd(4) == 0) put(&t, "\\n\\t\\u00e9");
+    put(&t, "\"");
+  }
+  put(&t, "]");
+  return t.data;
+}
+
+/* many documents nested a few hundred levels deep */
+static char *gen_deep(void) {
+  text_t t = {0};
+  int i, d;
+  put(&t, "[");
+  for (i = 0; i < 200; i++) {
+    put(&t, "%s", i ? "," : "");
+    for (d = 0; d < 256; d++) put(&t, d % 2 ? "[" : "{\"a\":");
+    put(&t, "%d", i);
+    for (d = 255; d >= 0; d--) put(&t, d % 2 ? "]" : "}");
+  }
+  put(&t, "]");
+  return t.data;
+}
+
+/* a single object with a lot of members, the parser checks each key
+ * against the previous ones so this stays at 10k */
+static char *gen_wide(void) {
+  text_t t = {0};
+  int i;
+  put(&t, "{");
+  for (i = 0; i < 10000; i++) {
+    put(&t, "%s\"key_%d\":", i ? "," : "", i);
+    switch (i % 3) {
+      case 0: put(&t, "%d", i); break;
+      case 1: put(&t, "\"value %d\"", i); break;
+      default: put(&t, "%s", i % 2 ? "true" : "null");
+    }
+  }
+  put(&t, "}");
+  return t.data;
+}
+
+/* a long array of mixed scalars, so it isn't packed */
+static char *gen_array(void) {
+  text_t t = {0};
+  int i;
+  put(&t, "[");
+  for (i = 0; i < 200000; i++) {
+    put(&t, "%s", i ? "," : "");
+    switch (i % 4) {
+      case 0: put(&t, "%d", i); break;
+      case 1: put(&t, "\"item%d\"", i); break;
+      case 2: put(&t, "%s", i % 3 ? "true" : "false"); break;
+      default: put(&t, "null");
+    }
+  }
+  put(&t, "]");
+  return t.data;
+}
+
+/* twitter.json like: statuses with nested user and entities objects */
+static char *gen_twitter(void) {
+  text_t t = {0};
+  int i, j;
+  put(&t, "{\"statuses\":[");
+  for (i = 0; i < 1500; i++) {
+    put(&t, "%s{\"metadata\":{\"result_type\":\"recent\",\"iso_language_code\":\"ja\"},", i ? "," : "");
+    put(&t, "\"created_at\":\"Sun Aug 31 00:29:%02d +0000 2014\",\"id\":%u%05u,\"id_str\":\"%u%05u\",",
+        i % 60, 50575 + i, rnd(100000), 50575 + i, rnd(100000));
+    put(&t, "\"text\":\"");
+    put_words(&t, 6 + rnd(14));
+    put(&t, "\",\"source\":\"web\",\"truncated\":false,");
+    put(&t, "\"in_reply_to_status_id\":null,\"in_reply_to_user_id\":null,\"in_reply_to_screen_name\":null,");
+    put(&t, "\"user\":{\"id\":%u,\"id_str\":\"%u\",\"name\":\"user %d\",\"screen_name\":\"user_%d\",\"location\":\"\",",
+        rnd(1000000000), rnd(1000000000), i, i);
+    put(&t, "\"description\":\"");
+    put_words(&t, 4 + rnd(10));
+    put(&t, "\",\"url\":null,\"entities\":{\"description\":{\"urls\":[]}},\"protected\":false,");
+    put(&t, "\"followers_count\":%u,\"friends_count\":%u,\"listed_count\":%u,\"favourites_count\":%u,",
+        rnd(5000), rnd(5000), rnd(50), rnd(20000));
+    put(&t, "\"utc_offset\":null,\"time_zone\":null,\"geo_enabled\":%s,\"verified\":false,\"statuses_count\":%u,",
+        i % 5 ? "false" : "true", rnd(100000));
+    put(&t, "\"lang\":\"ja\",\"profile_background_color\":\"C0DEED\",\"profile_image_url\":\"http://pbs.twimg.com/profile_images/%u/a.jpeg\",",
+        rnd(1000000));
+    put(&t, "\"default_profile\":true,\"following\":false,\"notifications\":false},");
+    put(&t, "\"geo\":null,\"coordinates\":null,\"place\":null,\"contributors\":null,\"retweet_count\":%u,\"favorite_count\":%u,",
+        rnd(100), rnd(100));
+    put(&t, "\"entities\":{\"hashtags\":[");
+    for (j = 0; j < (int)rnd(3); j++) put(&t, "%s{\"text\":\"%s\",\"indices\":[%d,%d]}", j ? "," : "", words[rnd(16)], j * 10, j * 10 + 8);
+    put(&t, "],\"symbols\":[],\"urls\":[],\"user_mentions\":[");
+    for (j = 0; j < (int)rnd(3); j++)
+      put(&t, "%s{\"screen_name\":\"user_%u\",\"name\":\"user\",\"id\":%u,\"indices\":[3,%d]}", j ? "," : "", rnd(1500), rnd(1000000), 10 + j);
+    put(&t, "]},\"favorited\":false,\"retweeted\":false,\"lang\":\"ja\"}");
+  }
+  put(&t, "],\"search_metadata\":{\"completed_in\":0.087,\"max_id\":505874924095815681,\"count\":100}}");
+  return t.data;
+}
+
+/* canada.json like: geojson polygons, long runs of coordinate pairs */
+static char *gen_canada(void) {
+  text_t t = {0};
+  int f, r, p;
+  put(&t, "{\"type\":\"FeatureCollection\",\"features\":[");
+  for (f = 0; f < 4; f++) {
+    put(&t, "%s{\"type\":\"Feature\",\"properties\":{\"name\":\"Canada\"},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[", f ? "," : "");
+    for (r = 0; r < 120; r++) {
+      put(&t, "%s[", r ? "," : "");
+      for (p = 0; p < 120; p++)
+        put(&t, "%s[%.15f,%.15f]", p ? "," : "", rnd_float(-141, -52), rnd_float(41, 84));
+      put(&t, "]");
+    }
+    put(&t, "]}}");
+  }
+  put(&t, "]}");
+  return t.data;
+}
+
+/* citm_catalog.json like: id keyed maps and performance/price arrays */
+static char *gen_citm(void) {
+  text_t t = {0};
+  int i, j;
+  put(&t, "{\"areaNames\":{");
+  for (i = 0; i < 200; i++) put(&t, "%s\"%d\":\"Area %d\"", i ? "," : "", 205705993 + i, i);
+  put(&t, "},\"events\":{");
+  for (i = 0; i < 2000; i++) {
+    put(&t, "%s\"%d\":{\"description\":null,\"id\":%d,\"logo\":%s,\"name\":\"", i ? "," : "", 138586341 + i, 138586341 + i,
+        i % 3 ? "null" : "\"/images/UE0AAAAACEKo6QAAAAZDSVRN\"");
+    put_words(&t, 2 + rnd(4));
+    put(&t, "\",\"subTopicIds\":[337184269,337184283],\"subjectCode\":null,\"subtitle\":null,\"topicIds\":[324846099,107888604]}");
+  }
+  put(&t, "},\"performances\":[");
+  for (i = 0; i < 2500; i++) {
+    put(&t, "%s{\"eventId\":%d,\"id\":%d,\"logo\":null,\"name\":null,\"prices\":[", i ? "," : "", 138586341 + i % 2000, 339887544 + i);
+    for (j = 0; j < 3; j++) put(&t, "%s{\"amount\":%u,\"audienceSubCategoryId\":337100890,\"seatCategoryId\":%d}", j ? "," : "", 9500 + rnd(90000), 338937295 + j);
+    put(&t, "],\"seatCategories\":[");
+    for (j = 0; j < 3; j++) put(&t, "%s{\"areas\":[{\"areaId\":%d,\"blockIds\":[]}],\"seatCategoryId\":%d}", j ? "," : "", 205705993 + (int)rnd(200), 338937295 + j);
+    put(&t, "],\"seatMapImage\":null,\"start\":%u000,\"venueCode\":\"PLEYEL_PLEYEL\"}", 1372701600 + i * 3600);
+  }
+  put(&t, "],\"venueNames\":{\"PLEYEL_PLEYEL\":\"Salle Pleyel\"}}");
+  return t.data;
+}
+
+typedef struct {
+  const char *name;
+  char *(*generate)(void);
+  const char *pointers[4];
+} corpus_t;
+
+static const corpus_t corpora[] = {
+  {"numbers", gen_numbers, {"/0", "/74999", "/149999", NULL}},
+  {"strings", gen_strings, {"/0", "/10000", "/19999", NULL}},
+  {"deep", gen_deep, {"/0/a/0/a/0/a/0", "/199/a/0/a", NULL}},
+  {"wide", gen_wide, {"/key_0", "/key_5000", "/key_9999", NULL}},
+  {"array", gen_array, {"/0", "/100000", "/199999", NULL}},
+  {"twitter", gen_twitter, {"/statuses/0/user/screen_name", "/statuses/750/entities/hashtags", "/search_metadata/count", NULL}},
+  {"canada", gen_canada, {"/type", "/features/3/geometry/coordinates/119/119/1", NULL}},
+  {"citm", gen_citm, {"/areaNames/205705993", "/events/138588340/name", "/performances/2499/prices/2/amount", NULL}}
+};
+
+/*================*
+ *    Measures    *
+ *================*/
+
+static long peak_rss_kb(void) {
+#if defined(BENCH_FORK)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage)) return -1;
+#if defined(__APPLE__)
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#else
+  return -1;
+#endif
+}
+
+static void report(const char *corpus, const char *op, size_t bytes, long rounds, double ns,
+                   long op_allocs, size_t op_bytes) {
+  printf("{\"corpus\":\"%s\",\"allocator\":\"%s\",\"op\":\"%s\",\"bytes\":%lu,\"rounds\":%ld,\"ns_op\":%.1f,",
+         corpus, BENCH_ALLOCATOR, op, (unsigned long)bytes, rounds, ns);
+  if (bytes) printf("\"mb_s\":%.2f,", bytes * 1e3 / ns);
+  else printf("\"mb_s\":null,");
+  printf("\"allocs\":%ld,\"alloc_bytes\":%lu,\"peak_rss_kb\":%ld}\n", op_allocs, (unsigned long)op_bytes, peak_rss_kb());
+  fflush(stdout);
+}
+
+#if defined(TJSON_STATS)
+/* the instrumentation counters of the last parse, as one more line */
+static void report_stats(const char *corpus) {
+  const tjson_stats_t *stats = tjson_get_stats();
+  int i;
+  printf("{\"corpus\":\"%s\",\"allocator\":\"%s\",\"op\":\"stats\",\"nodes\":%lu,\"string_bytes\":%lu,"
+         "\"allocs\":%lu,\"alloc_bytes\":%lu,\"max_depth\":%d,\"tokens\":{",
+         corpus, BENCH_ALLOCATOR, stats->nodes, stats->string_bytes, stats->allocs, stats->alloc_bytes, stats->max_depth);
+  for (i = 0; i < TJSON_STATS_TOKENS; i++)
+    printf("%s\"%s\":%lu", i ? "," : "", tjson_stats_token_name(i), stats->tokens[i]);
+  printf("},\"cycles\":{");
+  for (i = 0; i < TJSON_PHASE_COUNT; i++)
+    printf("%s\"%s\":%.0f", i ? "," : "", tjson_stats_phase_name(i), (double)stats->cycles[i]);
+  printf("}}\n");
+}
+#endif
+
+/* numbers are read in place, packed arrays keep their form */
+static int lookup(tjson_path_t *path, tjson_t *json) {
+  return tjson_path_opt_number(path, json, TJSON_NUMBER_ERROR) != TJSON_NUMBER_ERROR || tjson_path_get(path, json);
+}
+
+/* nodes visited through the public child/next api */
+static long walk(tjson_t *json) {
+  long nodes = 1;
+  tjson_t *el;
+  TJSON_TYPE_ type = tjson_get_type(json);
+  if (type != TJSON_ARRAY && type != TJSON_OBJECT) return nodes;
+  for (el = tjson_get_child(json); el; el = tjson_get_next(el)) nodes += walk(el);
+  return nodes;
+}
+
+static void run_corpus(const char *name, const char *text, const char *const *pointers) {
+  size_t bytes = strlen(text), out_bytes = 0, op_bytes;
+  double parse_ns = 0, delete_ns = 0, ns;
+  long rounds, r, count, nodes = 0;
+  tjson_path_t *paths[4];
+  int npaths = 0, i;
+  const char *out;
+  tjson_t *json;
+  clock_t start;
+
+  /* parse and delete, rounds picked from a first timed parse. Every later
+   * phase gets a freshly parsed tree, so one phase unpacking number arrays
+   * doesn't change what the next one measures */
+  start = clock();
+  json = tjson_parse(text);
+  ns = elapsed_ns(start);
+  if (!json) {
+    fprintf(stderr, "%s: failed to parse\n", name);
+    return;
+  }
+  tjson_delete(json);
+  rounds = ns > 0 ? (long)(BENCH_MIN_NS / ns) : 1000;
+  if (rounds < 3) rounds = 3;
+
+  for (r = 0; r < rounds; r++) {
+    start = clock();
+    json = tjson_parse(text);
+    parse_ns += elapsed_ns(start);
+    start = clock();
+    tjson_delete(json);
+    delete_ns += elapsed_ns(start);
+  }
+
+  allocs = 0;
+  alloc_bytes = 0;
+  json = tjson_parse(text);
+  report(name, "parse", bytes, rounds, parse_ns / rounds, allocs, alloc_bytes);
+  report(name, "delete", bytes, rounds, delete_ns / rounds, 0, 0);
+#if defined(TJSON_STATS)
+  report_stats(name);
+#endif
+
+  /* lookups, nothing to measure in MB/s */
+  if (pointers) {
+    for (i = 0; pointers[i]; i++) paths[npaths++] = tjson_path_compile(pointers[i]);
+    count = 0;
+    start = clock();
+    do {
+      for (r = 0; r < 1000; r++)
+        for (i = 0; i < npaths; i++) lookup(paths[i], json);
+      count += 1000 * npaths;
+      ns = elapsed_ns(start);
+    } while (ns < BENCH_MIN_NS / 5);
+    for (i = 0; i < npaths; i++) {
+      if (!lookup(paths[i], json)) fprintf(stderr, "%s: %s not found\n", name, pointers[i]);
+      tjson_path_free(paths[i]);
+    }
+    report(name, "lookup", 0, count, ns / count, 0, 0);
+  }
+  tjson_delete(json);
+
+  json = tjson_parse(text);
+  allocs = 0;
+  alloc_bytes = 0;
+  out = tjson_print(json);
+  r = allocs;
+  op_bytes = alloc_bytes;
+  if (out) {
+    tjson_t *back = tjson_parse(out);
+    if (!tjson_equal(json, back)) fprintf(stderr, "%s: printed text doesn't parse back equal\n", name);
+    tjson_delete(back);
+    out_bytes = strlen(out);
+    tjson_free((void *)out);
+  }
+  count = 0;
+  start = clock();
+  do {
+    tjson_free((void *)tjson_print(json));
+    count++;
+    ns = elapsed_ns(start);
+  } while (ns < BENCH_MIN_NS);
+  report(name, "serialize", out_bytes, count, ns / count, r, op_bytes);
+  tjson_delete(json);
+
+  /* the first walk creates the nodes of packed arrays, later ones reuse them */
+  json = tjson_parse(text);
+  count = 0;
+  start = clock();
+  do {
+    nodes = walk(json);
+    count++;
+    ns = elapsed_ns(start);
+  } while (ns < BENCH_MIN_NS);
+  report(name, "iterate", bytes, count, ns / count, 0, 0);
+  tjson_delete(json);
+  fprintf(stderr, "%s: %lu bytes, %ld nodes\n", name, (unsigned long)bytes, nodes);
+}
+
+static void run_text(const char *name, char *(*generate)(void), const char *path, const char *const *pointers) {
+#if defined(BENCH_FORK)
+  pid_t pid = fork();
+  if (pid > 0) {
+    waitpid(pid, NULL, 0);
+    return;
+  }
+#endif
+  {
+    char *text = NULL;
+    if (generate) {
+      text = generate();
+    } else {
+      FILE *fp = fopen(path, "rb");
+      long size;
+      if (fp) {
+        fseek(fp, 0, SEEK_END);
+        size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        text = malloc(size + 1);
+        text[fread(text, 1, size, fp)] = '\0';
+        fclose(fp);
+      } else {
+        fprintf(stderr, "Failed to open %s\n", path);
+      }
+    }
+    if (text) run_corpus(name, text, pointers);
+    free(text);
+    tjson_pool_free();
+  }
+#if defined(BENCH_FORK)
+  if (pid == 0) exit(0);
+#endif
+}
+
+int main(int argc, char **argv) {
+  int i, n = sizeof(corpora) / sizeof(corpora[0]);
+  tjson_set_allocator(count_malloc, count_realloc, NULL);
+  for (i = 0; i < n; i++) run_text(corpora[i].name, corpora[i].generate, NULL, corpora[i].pointers);
+  for (i = 1; i < argc; i++) run_text(argv[i], NULL, argv[i], NULL);
+  return 0;
+}
@@ -0,0 +1,695 @@
+#define TJSON_IMPLEMENTATION
+#include "tinyjson.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Behaviour and regression tests of the C API, run them under the address
+ * and undefined behaviour sanitizers: make test */
+
+static int failures = 0;
+
+#define CHECK(cond) check((cond) != 0, #cond, __LINE__)
+
+static void check(int ok, const char *what, int line) {
+  if (ok) return;
+  fprintf(stderr, "FAIL test_api.c:%d: %s\n", line, what);
+  failures++;
+}
+
+/* structural comparison against json text */
+static int same(tjson_t *json, const char *text) {
+  tjson_t *expected = tjson_parse(text);
+  int equal = tjson_equal(json, expected);
+  tjson_delete(expected);
+  return equal;
+}
+
+/*==============*
+ *     Pool     *
+ *==============*/
+
+#if !defined(TJSON_NO_POOL)
+static tjson_t *remote_node;
+
+static void *delete_remote(void *arg) {
+  (void)arg;
+  tjson_delete(remote_node);
+  tjson_pool_free();
+  return NULL;
+}
+
+static void *create_remote(void *arg) {
+  (void)arg;
+  remote_node = tjson_parse("{\"made\": \"elsewhere\", \"items\": [1, true, null]}");
+  tjson_pool_free();
+  return NULL;
+}
+#endif
+
+static void test_pool(void) {
+#if !defined(TJSON_NO_POOL)
+  pthread_t thread;
+  tjson_t *node, *again;
+
+  /* a deleted node is the next one handed out */
+  tjson_pool_free();
+  node = tjson_create_number(1);
+  tjson_delete(node);
+  again = tjson_create_string("reused");
+  CHECK(again == node);
+  CHECK(tjson_get_type(again) == TJSON_STRING && !strcmp(tjson_to_string(again), "reused"));
+  CHECK(tjson_get_name(again) == NULL && tjson_get_next(again) == NULL);
+
+  /* deleted on another thread, it comes back to this pool */
+  remote_node = again;
+  pthread_create(&thread, NULL, delete_remote, NULL);
+  pthread_join(thread, NULL);
+  node = tjson_create_null();
+  CHECK(node == again);
+  tjson_delete(node);
+
+  /* the blocks of an exited thread go with its last node */
+  pthread_create(&thread, NULL, create_remote, NULL);
+  pthread_join(thread, NULL);
+  CHECK(same(remote_node, "{\"made\": \"elsewhere\", \"items\": [1, true, null]}"));
+  tjson_delete(remote_node);
+
+  /* released with live nodes, freed by the last delete */
+  node = tjson_parse("[\"a\", {\"b\": 2}]");
+  tjson_pool_free();
+  again = tjson_create_bool(1);
+  CHECK(again != node);
+  tjson_delete(node);
+  tjson_delete(again);
+#endif
+}
+
+/*===============*
+ *    Pointer    *
+ *===============*/
+
+static const char *pointer_doc =
+  "{\"foo\": [\"bar\", \"baz\"], \"\": 0, \"a/b\": 1, \"c%d\": 2, \"e^f\": 3, \"g|h\": 4,"
+  " \" \": 7, \"m~n\": 8, \"~1\": 9, \"deep\": {\"list\": [{\"x\": 10}]}}";
+
+/* RFC 6901 section 5 examples, plus the cases that must not match */
+static void test_pointer(void) {
+  static const struct { const char *pointer; const char *expected; } cases[] = {
+    { "/foo", "[\"bar\", \"baz\"]" }, { "/foo/0", "\"bar\"" }, { "/", "0" },
+    { "/a~1b", "1" }, { "/c%d", "2" }, { "/e^f", "3" }, { "/g|h", "4" }, { "/ ", "7" },
+    { "/m~0n", "8" }, { "/~01", "9" }, { "/deep/list/0/x", "10" },
+    { "/foo/2", NULL }, { "/foo/01", NULL }, { "/foo/-", NULL }, { "/foo/bar", NULL },
+    { "/missing", NULL }, { "/a~2b", NULL }, { "/deep/list/0/x/y", NULL }, { "foo", NULL }
+  };
+  tjson_t *json = tjson_parse(pointer_doc);
+  tjson_t *other = tjson_parse("{\"deep\": {\"list\": [{\"x\": 11}]}}");
+  size_t i;
+
+  CHECK(tjson_pointer_get(json, "") == json);
+  for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    tjson_path_t *path = tjson_path_compile(cases[i].pointer);
+    tjson_t *found = tjson_pointer_get(json, cases[i].pointer);
+    if (cases[i].expected) {
+      check(found && same(found, cases[i].expected), cases[i].pointer, __LINE__);
+      check(path && tjson_path_get(path, json) == found, cases[i].pointer, __LINE__);
+    } else {
+      check(!found, cases[i].pointer, __LINE__);
+      check(!path || !tjson_path_get(path, json), cases[i].pointer, __LINE__);
+    }
+    tjson_path_free(path);
+  }
+
+  /* one compiled path against many documents */
+  {
+    tjson_path_t *path = tjson_path_compile("/deep/list/0/x");
+    CHECK(tjson_to_number(tjson_path_get(path, json)) == 10);
+    CHECK(tjson_to_number(tjson_path_get(path, other)) == 11);
+    CHECK(tjson_path_get(path, NULL) == NULL);
+    tjson_path_free(path);
+  }
+  CHECK(tjson_path_compile("/bad~") == NULL);
+  CHECK(tjson_path_compile("/bad~2") == NULL);
+  CHECK(tjson_path_compile("no/slash") == NULL);
+
+  tjson_delete(json);
+  tjson_delete(other);
+}
+
+/*===============*
+ *    Extract    *
+ *===============*/
+
+static int extract(const char *text, const char **pointers, int count, tjson_t **out) {
+  tjson_path_t *paths[8];
+  int i, matched;
+  for (i = 0; i < count; i++) paths[i] = tjson_path_compile(pointers[i]);
+  matched = tjson_extract(text, paths, count, out);
+  for (i = 0; i < count; i++) tjson_path_free(paths[i]);
+  return matched;
+}
+
+static void test_extract(void) {
+  const char *pointers[] = { "/a/b", "/c", "/list/1", "/missing", "/a/b", "/a" };
+  const char *text =
+    "{\"skip\": {\"s\": \"}]\\\"{[\", \"n\": [1, [2, {\"b\": 3}]]}, \"a\": {\"b\": [1, {\"x\": null}]},"
+    " \"list\": [true, \"two\", 3], \"c\": -4.5}";
+  tjson_t *out[6];
+  int i;
+
+  CHECK(extract(text, pointers, 6, out) == 5);
+  CHECK(same(out[0], "[1, {\"x\": null}]"));
+  CHECK(tjson_to_number(out[1]) == -4.5);
+  CHECK(same(out[2], "\"two\""));
+  CHECK(out[3] == NULL);
+  /* the same path twice gets two copies */
+  CHECK(out[4] != out[0] && same(out[4], "[1, {\"x\": null}]"));
+  CHECK(same(out[5], "{\"b\": [1, {\"x\": null}]}"));
+  for (i = 0; i < 6; i++) tjson_delete(out[i]);
+
+  /* malformed input is -1 with every output NULL, in or outside a match */
+  CHECK(extract("{\"a\": {\"b\": [1, 2,]}, \"c\": 1}", pointers, 2, out) == -1);
+  CHECK(out[0] == NULL && out[1] == NULL);
+  CHECK(extract("{\"c\": 1, \"a\": {\"b\": {\"k\" 1}}}", pointers, 2, out) == -1);
+  CHECK(out[0] == NULL && out[1] == NULL);
+  CHECK(extract("{\"c\": 1, \"x\" 2}", pointers, 2, out) == -1);
+  CHECK(out[1] == NULL);
+  CHECK(extract("{\"skip\": [1, {\"n\": 2}", pointers, 2, out) == -1);
+  CHECK(extract("{\"c\": 1, \"d\": 2,}", pointers, 2, out) == -1);
+  CHECK(tjson_extract(NULL, NULL, 1, out) == -1);
+}
+
+/*===============*
+ *    Binding    *
+ *===============*/
+
+typedef struct { short x; long y; } bind_vec2;
+typedef struct { char *tag; bind_vec2 at; } bind_item;
+typedef struct {
+  char *name;
+  char code[4];
+  int life;
+  float speed;
+  double ratio;
+  unsigned char alive;
+  bind_vec2 position;
+  int fixed[3];
+  int *list;
+  int list_count;
+  bind_item *items;
+  int items_count;
+  char *names[2];
+  int untouched;
+} bind_player;
+
+static const tjson_field_t vec2_fields[] = {
+  TJSON_FIELD("x", TJSON_BIND_INT, bind_vec2, x),
+  TJSON_FIELD("y", TJSON_BIND_INT, bind_vec2, y),
+  TJSON_FIELD_END
+};
+
+static const tjson_field_t item_fields[] = {
+  TJSON_FIELD("tag", TJSON_BIND_STRING, bind_item, tag),
+  TJSON_FIELD_STRUCT("at", bind_item, at, vec2_fields),
+  TJSON_FIELD_END
+};
+
+static const tjson_field_t player_fields[] = {
+  TJSON_FIELD("name", TJSON_BIND_STRING, bind_player, name),
+  TJSON_FIELD("code", TJSON_BIND_CHARS, bind_player, code),
+  TJSON_FIELD("life", TJSON_BIND_INT, bind_player, life),
+  TJSON_FIELD("speed", TJSON_BIND_FLOAT, bind_player, speed),
+  TJSON_FIELD("ratio", TJSON_BIND_DOUBLE, bind_player, ratio),
+  TJSON_FIELD("alive", TJSON_BIND_BOOL, bind_player, alive),
+  TJSON_FIELD_STRUCT("position", bind_player, position, vec2_fields),
+  TJSON_FIELD_ARRAY("fixed", TJSON_BIND_INT, bind_player, fixed),
+  TJSON_FIELD_VECTOR("list", TJSON_BIND_INT, bind_player, list, list_count),
+  TJSON_FIELD_STRUCT_VECTOR("items", bind_player, items, items_count, item_fields),
+  TJSON_FIELD_ARRAY("names", TJSON_BIND_STRING, bind_player, names),
+  TJSON_FIELD("untouched", TJSON_BIND_INT, bind_player, untouched),
+  TJSON_FIELD_END
+};
+
+static void test_bind(void) {
+  bind_player p;
+  memset(&p, 0, sizeof(p));
+  p.untouched = 42;
+
+  CHECK(tjson_bind("{\"name\": \"Player\", \"code\": \"ABCDEF\", \"life\": -10, \"speed\": 1.5,"
+                   " \"ratio\": 0.25, \"alive\": true, \"unknown\": {\"deep\": [1, {}]},"
+                   " \"position\": {\"x\": 3, \"y\": 70000, \"z\": 9},"
+                   " \"fixed\": [1, 2, 3, 4], \"list\": [5, 6, 7],"
+                   " \"items\": [{\"tag\": \"sword\", \"at\": {\"x\": 1}}, {\"tag\": \"bow\"}],"
+                   " \"names\": [\"a\", \"b\"]}", player_fields, &p) == 0);
+  CHECK(!strcmp(p.name, "Player"));
+  CHECK(!strcmp(p.code, "ABC"));
+  CHECK(p.life == -10 && p.speed == 1.5f && p.ratio == 0.25 && p.alive == 1);
+  CHECK(p.position.x == 3 && p.position.y == 70000);
+  /* extra elements of a fixed array are skipped */
+  CHECK(p.fixed[0] == 1 && p.fixed[2] == 3);
+  CHECK(p.list_count == 3 && p.list[0] == 5 && p.list[2] == 7);
+  CHECK(p.items_count == 2 && !strcmp(p.items[0].tag, "sword") && p.items[0].at.x == 1);
+  CHECK(!strcmp(p.items[1].tag, "bow") && p.items[1].at.x == 0);
+  CHECK(!strcmp(p.names[0], "a") && !strcmp(p.names[1], "b"));
+  CHECK(p.untouched == 42);
+
+  /* binding again and repeated keys replace, mismatched types are skipped */
+  CHECK(tjson_bind("{\"name\": \"x\", \"name\": \"y\", \"life\": \"ten\", \"list\": [1], \"list\": [2, 3],"
+                   " \"items\": [], \"names\": [\"c\"], \"alive\": 1}", player_fields, &p) == 0);
+  CHECK(!strcmp(p.name, "y") && p.life == -10 && p.alive == 1);
+  CHECK(p.list_count == 2 && p.list[0] == 2);
+  CHECK(p.items_count == 0);
+  CHECK(!strcmp(p.names[0], "c") && !strcmp(p.names[1], "b"));
+
+  /* errors after elements were bound, including partly bound ones */
+  CHECK(tjson_bind("{\"items\": [{\"tag\": \"a\"}, {\"tag\": \"b\", \"at\": {\"x\": 1,}}]}", player_fields, &p) == -1);
+  CHECK(tjson_bind("{\"items\": [{\"tag\": \"a\"}, {\"tag\": \"b\"} {}]}", player_fields, &p) == -1);
+  CHECK(tjson_bind("{\"list\": [1, 2,]}", player_fields, &p) == -1);
+  CHECK(tjson_bind("{\"name\" \"z\"}", player_fields, &p) == -1);
+  CHECK(tjson_bind("[1]", player_fields, &p) == -1);
+  CHECK(p.items_count == 0 && p.list_count == 2);
+
+  tjson_bind_free(player_fields, &p);
+  CHECK(p.name == NULL && p.list == NULL && p.list_count == 0 && p.names[0] == NULL);
+}
+
+/*=====================*
+ *    Packed arrays    *
+ *=====================*/
+
+static void test_packed(void) {
+  tjson_t *json = tjson_parse("{\"items\": [1, 2.5, -3], \"grid\": [[1, 2], [3, 4]], \"mixed\": [1, \"a\"]}");
+  tjson_t *items = tjson_object_get(json, "items");
+  tjson_path_t *path = tjson_path_compile("/grid/1/0");
+  tjson_path_t *too_deep = tjson_path_compile("/items/0/x");
+  int count;
+
+  CHECK(tjson_array_numbers(items, &count) && count == 3);
+  CHECK(tjson_array_numbers(tjson_object_get(json, "mixed"), &count) == NULL && count == 0);
+
+  /* element reads that don't need a node leave the array packed */
+  CHECK(tjson_array_get_number(items, 1) == 2.5);
+  CHECK(tjson_array_opt_number(items, 3, 7) == 7 && tjson_array_opt_number(items, -1, 7) == 7);
+  CHECK(tjson_array_get_string(items, 0) == NULL && tjson_array_get_object(items, 0) == NULL);
+  CHECK(tjson_array_opt_bool(items, 0, 5) == 5);
+  CHECK(tjson_pointer_opt_number(json, "/items/2", 0) == -3);
+  CHECK(tjson_pointer_opt_number(json, "/items/3", 9) == 9 && tjson_pointer_opt_number(json, "/items/0/x", 9) == 9);
+  CHECK(tjson_pointer_opt_number(json, "/mixed/0", 0) == 1 && tjson_pointer_opt_number(json, "/mixed/1", 0) == 0);
+  CHECK(tjson_path_opt_number(path, json, 0) == 3 && tjson_path_opt_number(too_deep, json, 9) == 9);
+  CHECK(tjson_pointer_get(json, "/items/0/x") == NULL && tjson_path_get(too_deep, json) == NULL);
+  CHECK(tjson_array_numbers(items, NULL) && tjson_array_numbers(tjson_pointer_get(json, "/grid/1"), NULL));
+
+  /* handing out a node creates them, and the array never packs again so
+   * the node stays valid (930d46f) */
+  tjson_t *first = tjson_pointer_get(json, "/items/0");
+  CHECK(tjson_to_number(first) == 1 && tjson_array_numbers(items, &count) == NULL && count == 0);
+  tjson_array_push_number(items, 4);
+  CHECK(tjson_array_numbers(items, NULL) == NULL && tjson_array_get(items, 0) == first);
+  CHECK(tjson_to_number(first) == 1 && tjson_array_get_number(items, 3) == 4);
+  CHECK(same(items, "[1, 2.5, -3, 4]"));
+  CHECK(tjson_to_number(tjson_path_get(path, json)) == 3 && !tjson_array_numbers(tjson_pointer_get(json, "/grid/1"), NULL));
+
+  /* pushes and pops stay packed */
+  tjson_t *numbers = tjson_create_array();
+  tjson_array_push_number(numbers, 1);
+  tjson_array_push_number(numbers, 2);
+  CHECK(tjson_array_numbers(numbers, &count) && count == 2);
+  CHECK(tjson_array_pop_number(numbers) == 2 && tjson_array_pop_number(numbers) == 1);
+  CHECK(tjson_array_pop_number(numbers) == TJSON_NUMBER_ERROR && tjson_get_child(numbers) == NULL);
+  tjson_delete(numbers);
+
+  /* frozen arrays are read in place too, their nodes are built aside */
+  tjson_shared_t *shared = tjson_share(tjson_parse("{\"items\": [1, 2, 3]}"));
+  items = tjson_object_get(tjson_shared_get(shared), "items");
+  CHECK(tjson_array_get_number(items, 2) == 3 && tjson_pointer_opt_number(tjson_shared_get(shared), "/items/0", 0) == 1);
+  CHECK(tjson_is_frozen(tjson_array_get(items, 1)) && tjson_to_number(tjson_array_get(items, 1)) == 2);
+  CHECK(tjson_array_numbers(items, &count) && count == 3);
+  /* pops on a frozen array change nothing, packed or not */
+  CHECK(tjson_array_pop_number(items) == TJSON_NUMBER_ERROR && tjson_array_numbers(items, &count) && count == 3);
+  tjson_shared_release(shared);
+  shared = tjson_share(tjson_parse("[1, \"a\"]"));
+  CHECK(tjson_array_pop_number(tjson_shared_get(shared)) == TJSON_NUMBER_ERROR);
+  CHECK(same(tjson_shared_get(shared), "[1, \"a\"]"));
+  tjson_shared_release(shared);
+
+  tjson_path_free(path);
+  tjson_path_free(too_deep);
+  tjson_delete(json);
+}
+
+/*=================*
+ *    Reparsing    *
+ *=================*/
+
+static long allocations = 0;
+
+static void *counting_malloc(size_t size) {
+  allocations++;
+  return malloc(size);
+}
+
+static void *counting_realloc(void *ptr, size_t size) {
+  allocations++;
+  return realloc(ptr, size);
+}
+
+static void test_reparse(void) {
+  tjson_t *json = tjson_reparse(NULL, "{\"name\": \"first\", \"items\": [1, 2, 3], \"at\": {\"x\": 1}}");
+  tjson_t *root = json;
+  CHECK(same(json, "{\"name\": \"first\", \"items\": [1, 2, 3], \"at\": {\"x\": 1}}"));
+
+  /* a similar shape reuses everything, the root included */
+  json = tjson_reparse(json, "{\"name\": \"other\", \"items\": [4, 5, 6], \"at\": {\"y\": 2}}");
+  CHECK(json == root && same(json, "{\"name\": \"other\", \"items\": [4, 5, 6], \"at\": {\"y\": 2}}"));
+  allocations = 0;
+  tjson_set_allocator(counting_malloc, counting_realloc, NULL);
+  json = tjson_reparse(json, "{\"name\": \"third\", \"items\": [7, 8], \"at\": {\"z\": 3}}");
+  tjson_set_allocator(NULL, NULL, NULL);
+  CHECK(allocations == 0 && same(json, "{\"name\": \"third\", \"items\": [7, 8], \"at\": {\"z\": 3}}"));
+
+  /* the shape changes: other root type, packed arrays gaining other values,
+   * deeper and wider trees, longer strings, then back to less */
+  json = tjson_reparse(json, "[1, \"a\", [2, 3], null]");
+  CHECK(same(json, "[1, \"a\", [2, 3], null]") && tjson_array_numbers(json, NULL) == NULL);
+  json = tjson_reparse(json, "[1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17]");
+  CHECK(tjson_array_numbers(json, NULL) && tjson_array_get_number(json, 16) == 17);
+  json = tjson_reparse(json, "{\"a\": {\"b\": {\"c\": [true, false, {\"d\": \"a much longer string than before\"}]}}}");
+  CHECK(same(json, "{\"a\": {\"b\": {\"c\": [true, false, {\"d\": \"a much longer string than before\"}]}}}"));
+  json = tjson_reparse(json, "\"just a string\"");
+  CHECK(tjson_get_type(json) == TJSON_STRING && !strcmp(tjson_to_string(json), "just a string"));
+  json = tjson_reparse(json, "{}");
+  CHECK(same(json, "{}") && tjson_get_child(json) == NULL);
+
+  /* a member keeps its name and its later siblings (4342777) */
+  tjson_t *object = tjson_parse("{\"a\": {\"x\": 1}, \"b\": 2, \"c\": [3]}");
+  tjson_t *member = tjson_object_get(object, "a");
+  CHECK(tjson_reparse(member, "[1, 2]") == member);
+  CHECK(same(object, "{\"a\": [1, 2], \"b\": 2, \"c\": [3]}") && !strcmp(tjson_get_name(member), "a"));
+  tjson_delete(object);
+
+  /* frozen trees aren't touched */
+  tjson_shared_t *shared = tjson_share(tjson_parse("[1]"));
+  CHECK(tjson_reparse(tjson_shared_get(shared), "[2]") == NULL && tjson_array_get_number(tjson_shared_get(shared), 0) == 1);
+  tjson_shared_release(shared);
+  tjson_delete(json);
+}
+
+/*=========================*
+ *    Clone and compare    *
+ *=========================*/
+
+static void test_compare(void) {
+  const char *text = "{\"name\": \"a\", \"n\": [1, 2, 3], \"o\": {\"x\": [true, null, \"s\"], \"y\": -0.5}}";
+  tjson_t *json = tjson_parse(text);
+  tjson_t *copy = tjson_clone(json);
+  tjson_t *reordered = tjson_parse("{\"o\": {\"y\": -0.5, \"x\": [true, null, \"s\"]}, \"n\": [1, 2, 3], \"name\": \"a\"}");
+  char key[16];
+  int i;
+
+  /* deep and independent, packed arrays stay packed */
+  CHECK(copy != json && tjson_equal(json, copy) && tjson_hash(json) == tjson_hash(copy));
+  CHECK(tjson_array_numbers(tjson_object_get(copy, "n"), NULL) != tjson_array_numbers(tjson_object_get(json, "n"), NULL));
+  tjson_object_set_number(tjson_object_get(copy, "o"), "y", 2);
+  CHECK(!tjson_equal(json, copy) && same(json, text));
+  tjson_delete(copy);
+
+  /* member order is ignored, at every level */
+  CHECK(tjson_equal(json, reordered) && tjson_equal(reordered, json));
+  CHECK(tjson_hash(json) == tjson_hash(reordered));
+
+  /* wide objects take the indexed path */
+  tjson_t *wide = tjson_create_object(), *wide_reversed = tjson_create_object();
+  for (i = 0; i < 40; i++) {
+    sprintf(key, "k%d", i);
+    tjson_object_set_number(wide, key, i);
+    sprintf(key, "k%d", 39 - i);
+    tjson_object_set_number(wide_reversed, key, 39 - i);
+  }
+  CHECK(tjson_equal(wide, wide_reversed) && tjson_hash(wide) == tjson_hash(wide_reversed));
+  tjson_object_set_number(wide_reversed, "k7", 70);
+  CHECK(!tjson_equal(wide, wide_reversed));
+  tjson_delete(wide);
+  tjson_delete(wide_reversed);
+
+  /* packed and node arrays of the same numbers compare and hash alike */
+  tjson_t *nodes = tjson_create_array();
+  for (i = 1; i <= 3; i++) tjson_array_push(nodes, tjson_create_number(i));
+  CHECK(tjson_array_numbers(nodes, NULL) == NULL && tjson_array_numbers(tjson_object_get(json, "n"), NULL));
+  CHECK(tjson_equal(nodes, tjson_object_get(json, "n")) && tjson_equal(tjson_object_get(json, "n"), nodes));
+  CHECK(tjson_hash(nodes) == tjson_hash(tjson_object_get(json, "n")));
+  tjson_array_push(nodes, tjson_create_number(4));
+  CHECK(!tjson_equal(nodes, tjson_object_get(json, "n")) && !tjson_equal(tjson_object_get(json, "n"), nodes));
+  tjson_delete(nodes);
+
+  /* -0 equals 0, so it hashes the same */
+  tjson_t *zero = tjson_create_number(0), *negative_zero = tjson_create_number(-0.0);
+  CHECK(tjson_equal(zero, negative_zero) && tjson_hash(zero) == tjson_hash(negative_zero));
+  tjson_delete(zero);
+  tjson_delete(negative_zero);
+
+  /* differences that must be seen */
+  const char *pairs[][2] = {
+    {"[1, 2]", "[2, 1]"},
+    {"{\"a\": 1}", "{\"a\": 1, \"b\": 2}"},
+    {"{\"a\": 1, \"b\": 2}", "{\"a\": 1, \"c\": 2}"},
+    {"{\"a\": 1}", "{\"a\": \"1\"}"},
+    {"[null]", "[false]"},
+    {"[[]]", "[{}]"},
+    {"{\"a\": {\"b\": [1]}}", "{\"a\": {\"b\": [1.5]}}"},
+    {"\"ab\"", "\"abc\""}
+  };
+  for (i = 0; i < (int)(sizeof(pairs) / sizeof(pairs[0])); i++) {
+    tjson_t *a = tjson_parse(pairs[i][0]), *b = tjson_parse(pairs[i][1]);
+    CHECK(!tjson_equal(a, b) && !tjson_equal(b, a));
+    tjson_delete(a);
+    tjson_delete(b);
+  }
+
+  /* a clone of a shared tree is an ordinary, writable one */
+  tjson_shared_t *shared = tjson_share(tjson_clone(json));
+  copy = tjson_clone(tjson_shared_get(shared));
+  CHECK(!tjson_is_frozen(copy) && !tjson_is_frozen(tjson_object_get(copy, "o")) && tjson_equal(copy, json));
+  tjson_array_push_number(tjson_object_get(copy, "n"), 4);
+  CHECK(tjson_array_get_number(tjson_object_get(copy, "n"), 3) == 4);
+  tjson_shared_release(shared);
+  tjson_delete(copy);
+
+  tjson_delete(reordered);
+  tjson_delete(json);
+}
+
+/*===================*
+ *    Merge patch    *
+ *===================*/
+
+/* RFC 7386 Appendix A: original, patch, result */
+static const char *merge_vectors[][3] = {
+  {"{\"a\": \"b\"}", "{\"a\": \"c\"}", "{\"a\": \"c\"}"},
+  {"{\"a\": \"b\"}", "{\"b\": \"c\"}", "{\"a\": \"b\", \"b\": \"c\"}"},
+  {"{\"a\": \"b\"}", "{\"a\": null}", "{}"},
+  {"{\"a\": \"b\", \"b\": \"c\"}", "{\"a\": null}", "{\"b\": \"c\"}"},
+  {"{\"a\": [\"b\"]}", "{\"a\": \"c\"}", "{\"a\": \"c\"}"},
+  {"{\"a\": \"c\"}", "{\"a\": [\"b\"]}", "{\"a\": [\"b\"]}"},
+  {"{\"a\": {\"b\": \"c\"}}", "{\"a\": {\"b\": \"d\", \"c\": null}}", "{\"a\": {\"b\": \"d\"}}"},
+  {"{\"a\": [{\"b\": \"c\"}]}", "{\"a\": [1]}", "{\"a\": [1]}"},
+  {"[\"a\", \"b\"]", "[\"c\", \"d\"]", "[\"c\", \"d\"]"},
+  {"{\"a\": \"b\"}", "[\"c\"]", "[\"c\"]"},
+  {"{\"a\": \"foo\"}", "null", "null"},
+  {"{\"a\": \"foo\"}", "\"bar\"", "\"bar\""},
+  {"{\"e\": null}", "{\"a\": 1}", "{\"e\": null, \"a\": 1}"},
+  {"[1, 2]", "{\"a\": \"b\", \"c\": null}", "{\"a\": \"b\"}"},
+  {"{}", "{\"a\": {\"bb\": {\"ccc\": null}}}", "{\"a\": {\"bb\": {}}}"}
+};
+
+static void test_merge(void) {
+  int i;
+  for (i = 0; i < (int)(sizeof(merge_vectors) / sizeof(merge_vectors[0])); i++) {
+    tjson_t *target = tjson_parse(merge_vectors[i][0]);
+    tjson_t *patch = tjson_parse(merge_vectors[i][1]);
+    tjson_t *result = tjson_parse(merge_vectors[i][2]);
+
+    tjson_t *patched = tjson_merge_patch(tjson_clone(target), patch);
+    if (!tjson_equal(patched, result)) fprintf(stderr, "merge vector %d\n", i + 1);
+    CHECK(tjson_equal(patched, result));
+    CHECK(same(patch, merge_vectors[i][1]));
+
+    /* the diff between original and result patches one into the other */
+    tjson_t *diff = tjson_merge_diff(target, result);
+    tjson_t *applied = tjson_merge_patch(target, diff);
+    if (!tjson_equal(applied, result)) fprintf(stderr, "diff of merge vector %d\n", i + 1);
+    CHECK(tjson_equal(applied, result));
+
+    tjson_delete(applied);
+    tjson_delete(diff);
+    tjson_delete(patched);
+    tjson_delete(result);
+    tjson_delete(patch);
+  }
+
+  /* diffs only name what changed */
+  tjson_t *from = tjson_parse("{\"a\": 1, \"b\": {\"c\": 1, \"d\": 2}, \"e\": [1], \"gone\": true}");
+  tjson_t *to = tjson_parse("{\"a\": 1, \"b\": {\"c\": 1, \"d\": 3}, \"e\": [1], \"new\": \"x\"}");
+  tjson_t *diff = tjson_merge_diff(from, to);
+  CHECK(same(diff, "{\"b\": {\"d\": 3}, \"gone\": null, \"new\": \"x\"}"));
+  tjson_delete(diff);
+  diff = tjson_merge_diff(from, from);
+  CHECK(same(diff, "{}"));
+  tjson_delete(diff);
+
+  /* a null member can't be set by a patch, it removes the member */
+  tjson_t *with_null = tjson_parse("{\"a\": 1, \"b\": null}");
+  diff = tjson_merge_diff(from, with_null);
+  from = tjson_merge_patch(from, diff);
+  CHECK(same(from, "{\"a\": 1}"));
+  tjson_delete(diff);
+  tjson_delete(with_null);
+
+  /* frozen targets are refused */
+  tjson_shared_t *shared = tjson_share(tjson_parse("{\"a\": 1}"));
+  CHECK(tjson_merge_patch(tjson_shared_get(shared), to) == NULL && same(tjson_shared_get(shared), "{\"a\": 1}"));
+  tjson_shared_release(shared);
+
+  tjson_delete(from);
+  tjson_delete(to);
+}
+
+/*==============*
+ *    Binary    *
+ *==============*/
+
+static const char *binary_doc =
+    "{\"name\": \"forest\", \"tags\": [\"a\", \"forest\", \"\"], \"ints\": [0, -1, 300, 9007199254740992],"
+    " \"reals\": [0.5, -2.25, 1e300], \"mixed\": [1, \"x\", null, true, false, {}, []],"
+    " \"big\": -123456789012, \"frac\": 3.75, \"empty\": {}, \"deep\": {\"a\": {\"b\": [{\"forest\": 1}]}}}";
+
+static void test_binary(void) {
+  tjson_t *json = tjson_parse(binary_doc);
+  size_t size = 0, i;
+  unsigned char *image = tjson_encode(json, &size);
+  tjson_t *copy = tjson_decode(image, size);
+  tjson_view_t root, view, el;
+  const double *reals;
+  int count, len;
+
+  CHECK(image && size < strlen(binary_doc));
+  CHECK(tjson_equal(json, copy));
+  CHECK(tjson_array_numbers(tjson_object_get(copy, "ints"), &count) && count == 4);
+  CHECK(tjson_array_numbers(tjson_object_get(copy, "reals"), &count) && count == 3);
+
+  /* every byte is written, padding included (adcf964): the decoded tree
+   * encodes back to the same image */
+  size_t again_size = 0;
+  unsigned char *again = tjson_encode(copy, &again_size);
+  CHECK(again && again_size == size && !memcmp(again, image, size));
+  tjson_free(again);
+  tjson_delete(copy);
+
+  /* -0.0 keeps its sign, tjson_equal can't tell */
+  double negative_zero = -0.0, number;
+  tjson_t *zero = tjson_create_number(negative_zero);
+  unsigned char *zero_image = tjson_encode(zero, &size);
+  copy = tjson_decode(zero_image, size);
+  number = tjson_to_number(copy);
+  CHECK(copy && !memcmp(&number, &negative_zero, sizeof(double)));
+  tjson_delete(copy);
+  tjson_delete(zero);
+  tjson_free(zero_image);
+
+  /* in place reads */
+  size = 0;
+  tjson_free(image);
+  image = tjson_encode(json, &size);
+  CHECK(tjson_view_open(&root, image, size) == 0);
+  CHECK(tjson_view_type(&root) == TJSON_OBJECT && tjson_view_count(&root) == 9);
+  CHECK(tjson_view_get(&root, "name", &view) && !strcmp(tjson_view_name(&view), "name"));
+  CHECK(!strcmp(tjson_view_string(&view, &len), "forest") && len == 6);
+  CHECK(tjson_view_get(&root, "ints", &view) && tjson_view_numbers(&view, &count) == NULL);
+  CHECK(tjson_view_at(&view, 1, &el) && tjson_view_number(&el) == -1);
+  CHECK(tjson_view_at(&view, 3, &el) && tjson_view_number(&el) == 9007199254740992.0);
+  CHECK(!tjson_view_at(&view, 4, &el));
+  CHECK(tjson_view_get(&root, "reals", &view) && (reals = tjson_view_numbers(&view, &count)) != NULL);
+  CHECK(count == 3 && reals[1] == -2.25 && (size_t)reals % sizeof(double) == 0);
+  CHECK(tjson_view_at(&view, 2, &el) && tjson_view_number(&el) == 1e300);
+  CHECK(tjson_view_get(&root, "mixed", &view) && tjson_view_at(&view, 3, &el) && tjson_view_bool(&el));
+  CHECK(tjson_view_at(&view, 2, &el) && tjson_view_type(&el) == TJSON_NULL);
+  CHECK(tjson_view_at(&view, 5, &el) && tjson_view_type(&el) == TJSON_OBJECT && !tjson_view_child(&el, &el));
+  CHECK(tjson_view_number(&view) == TJSON_NUMBER_ERROR && tjson_view_string(&view, NULL) == NULL);
+  CHECK(tjson_view_get(&root, "big", &view) && tjson_view_number(&view) == -123456789012.0);
+  CHECK(tjson_view_get(&root, "frac", &view) && tjson_view_number(&view) == 3.75);
+  CHECK(!tjson_view_get(&root, "missing", &view) && !tjson_view_next(&root));
+  CHECK(tjson_view_get(&root, "deep", &view) && tjson_view_get(&view, "a", &view));
+  copy = tjson_view_decode(&view);
+  CHECK(same(copy, "{\"b\": [{\"forest\": 1}]}") && !strcmp(tjson_get_name(copy), "a"));
+  tjson_delete(copy);
+
+  /* names and repeated strings are stored once */
+  count = 0;
+  for (i = 0; i + 6 <= size; i++) count += !memcmp(image + i, "forest", 6);
+  CHECK(count == 1);
+
+  /* unaligned buffers are copied */
+  unsigned char *shifted = malloc(size + 1);
+  memcpy(shifted + 1, image, size);
+  CHECK(tjson_view_open(&root, shifted + 1, size) == -1);
+  copy = tjson_decode(shifted + 1, size);
+  CHECK(tjson_equal(json, copy));
+  tjson_delete(copy);
+  free(shifted);
+
+  /* files, read back through a mapping */
+  CHECK(tjson_save_binary(json, "test_api.bin") == 0);
+  copy = tjson_open_binary("test_api.bin");
+  CHECK(tjson_equal(json, copy));
+  tjson_delete(copy);
+  tjson_mapping_t *mapping = tjson_map_binary("test_api.bin", &root);
+  CHECK(mapping && tjson_view_get(&root, "tags", &view) && tjson_view_at(&view, 1, &el));
+  CHECK(!strcmp(tjson_view_string(&el, NULL), "forest"));
+  tjson_unmap_binary(mapping);
+  remove("test_api.bin");
+
+  /* truncated images are rejected */
+  unsigned char *part = malloc(size);
+  for (i = 0; i < size; i += i < 24 ? 1 : 7) {
+    memcpy(part, image, i);
+    CHECK(tjson_decode(part, i) == NULL);
+  }
+
+  /* corrupted ones are rejected or decode to something, never read outside */
+  int rejected = 0;
+  for (i = 0; i < size; i++) {
+    memcpy(part, image, size);
+    part[i] ^= 0xff;
+    copy = tjson_decode(part, size);
+    rejected += copy == NULL;
+    tjson_delete(copy);
+  }
+  CHECK(rejected > 16);
+  memcpy(part, image, size);
+  part[5] ^= 3; /* other byte order */
+  CHECK(tjson_decode(part, size) == NULL);
+  free(part);
+
+  tjson_free(image);
+  tjson_delete(json);
+}
+
+int main(void) {
+  test_pool();
+  test_pointer();
+  test_extract();
+  test_bind();
+  test_packed();
+  test_reparse();
+  test_compare();
+  test_merge();
+  test_binary();
+  tjson_pool_free();
+  if (failures) {
+    fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  puts("api: ok");
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include "tinyjson.hpp"
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/* Tests of the C++17 wrapper, the implementation comes from tinyjson.c:
+ * make test */
+
+static int failures = 0;
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+static void check(bool ok, const char *what, int line) {
+  if (ok) return;
+  std::fprintf(stderr, "FAIL test_hpp.cpp:%d: %s\n", line, what);
+  failures++;
+}
+
+static const char *player =
+    "{\"name\": \"Player\", \"life\": 10, \"speed\": 95.5, \"alive\": true, \"none\": null,"
+    " \"position\": {\"x\": 10, \"y\": -3}, \"items\": [15, 25, 55], \"tags\": [\"a\", \"b\"]}";
+
+static void test_get() {
+  auto doc = tjson::Document::parse(player);
+  CHECK(doc && doc.root().is_object());
+
+  CHECK(doc["name"].get<std::string_view>() == "Player");
+  CHECK(std::string_view(doc["name"].get<const char *>()) == "Player");
+  CHECK(doc["life"].get<int>() == 10 && doc["speed"].get<double>() == 95.5);
+  CHECK(doc["position"]["y"].get<long>() == -3);
+  CHECK(doc["alive"].get<bool>() && doc["none"].is_null());
+  CHECK(doc["items"][1].get<int>() == 25 && doc[std::string("tags")][0].get<std::string_view>() == "a");
+
+  /* missing nodes and mismatched types give zero values */
+  tjson::Value missing = doc["nope"]["deeper"];
+  CHECK(!missing && missing.type() == tjson::Type::Null);
+  CHECK(missing.get<int>() == 0 && missing.get<std::string_view>().empty() && !missing.get<bool>());
+  CHECK(doc["name"].get<int>() == 0 && doc["life"].get<const char *>() == nullptr);
+  CHECK(!doc["items"][3] && !doc["life"][0] && !doc["items"]["x"]);
+
+  /* get_or falls back on type mismatch, Value only for missing nodes */
+  CHECK(doc["life"].get_or(7) == 10 && doc["name"].get_or(7) == 7);
+  CHECK(doc["name"].get_or(std::string_view("x")) == "Player" && doc["life"].get_or(std::string_view("x")) == "x");
+  CHECK(doc["alive"].get_or(false) && doc["life"].get_or(true));
+  tjson::Value fallback = doc["name"];
+  CHECK(doc["position"].get_or(fallback).is_object() && doc["items"].get_or(fallback).is_array());
+  CHECK(doc["nope"].get_or(fallback).get<std::string_view>() == "Player");
+
+  CHECK(doc["position"]["x"].name() == "x" && doc.root().name().empty());
+}
+
+static void test_iterate() {
+  auto doc = tjson::Document::parse(player);
+
+  int sum = 0;
+  for (tjson::Value item : doc["items"]) sum += item.get<int>();
+  CHECK(sum == 95);
+
+  std::string names;
+  for (tjson::Value member : doc["position"]) names += std::string(member.name());
+  CHECK(names == "xy");
+
+  int count = 0;
+  for (tjson::Value member : doc) count += member ? 1 : 0;
+  CHECK(count == 8);
+
+  /* scalars and missing nodes iterate as empty */
+  for (tjson::Value none : doc["life"]) CHECK(!none);
+  for (tjson::Value none : doc["nope"]) CHECK(!none);
+  CHECK(doc["tags"].begin() != doc["tags"].end() && doc["life"].begin() == doc["life"].end());
+}
+
+static void test_move() {
+  auto doc = tjson::Document::parse(player);
+  tjson_t *handle = doc.handle();
+
+  tjson::Document moved(std::move(doc));
+  CHECK(!doc && moved.handle() == handle);
+
+  tjson::Document other = tjson::Document::parse("[1]");
+  other = std::move(moved);
+  CHECK(!moved && other.handle() == handle && other["life"].get<int>() == 10);
+
+  auto copy = other.clone();
+  CHECK(copy.handle() != handle && copy.root() == other.root());
+  CHECK(copy["position"] == other["position"] && copy["items"] != other["tags"]);
+
+  tjson_t *released = copy.release();
+  CHECK(!copy && released);
+  tjson_delete(released);
+}
+
+static void test_reparse() {
+  tjson::Document doc;
+  CHECK(doc.reparse("{\"a\": [1, 2]}") && doc["a"][1].get<int>() == 2);
+  tjson_t *handle = doc.handle();
+
+  CHECK(doc.reparse("{\"b\": \"c\"}") && doc.handle() == handle);
+  CHECK(!doc["a"] && doc["b"].get<std::string_view>() == "c");
+  CHECK(doc.reparse("[true, null]") && doc[0].get<bool>() && doc[1].is_null());
+
+  CHECK(!doc.reparse(nullptr) && doc.root().is_array());
+}
+
+int main() {
+  test_get();
+  test_iterate();
+  test_move();
+  test_reparse();
+  tjson_pool_free();
+  if (failures) {
+    std::fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  std::puts("hpp: ok");
+  return 0;
+}
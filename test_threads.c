@@ -0,0 +1,171 @@
+/* readers now and then stall inside tjson_slot_acquire */
+struct tjson_slot_s;
+static void slot_stall(struct tjson_slot_s *slot);
+#define TJSON_SLOT_STALL(slot) slot_stall(slot)
+
+#define TJSON_IMPLEMENTATION
+#include "tinyjson.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Stress tests for the parts meant to be used from many threads, run them
+ * under ThreadSanitizer: make test */
+
+#define READERS 6
+
+static int failures = 0;
+
+static void check(int ok, const char *what) {
+  if (ok) return;
+  fprintf(stderr, "FAIL: %s\n", what);
+  __atomic_add_fetch(&failures, 1, __ATOMIC_SEQ_CST);
+}
+
+/* every version holds "version": v and "items": [v, v+1, ..., v+7] */
+static tjson_shared_t *make_version(int version) {
+  char text[256];
+  sprintf(text, "{\"version\": %d, \"items\": [%d, %d, %d, %d, %d, %d, %d, %d]}", version,
+          version, version + 1, version + 2, version + 3, version + 4, version + 5, version + 6, version + 7);
+  return tjson_share(tjson_parse(text));
+}
+
+static tjson_slot_t *slot;
+static int readers_done = 0;
+
+/* Every 32nd acquire lets one publish through between reading the epoch and
+ * counting itself in, then two more before retaining what it loaded: the
+ * version it loaded is gone from the slot by then and must not be freed. */
+static void slot_stall(tjson_slot_t *stalled) {
+  static __thread int calls = 0;
+  int step = calls++ % 32;
+  long epoch;
+  int spin;
+  if (step >= 2) return;
+  epoch = __atomic_load_n(&stalled->epoch, __ATOMIC_SEQ_CST) + 1 + step;
+  for (spin = 0; spin < 1000 && __atomic_load_n(&stalled->epoch, __ATOMIC_SEQ_CST) < epoch; spin++) sched_yield();
+}
+
+static void *slot_reader(void *arg) {
+  int i = 0;
+  (void)arg;
+  while (i < 2000) {
+    tjson_shared_t *shared = tjson_slot_acquire(slot);
+    tjson_t *json = tjson_shared_get(shared);
+    tjson_t *items = tjson_object_get(json, "items");
+    int version = tjson_to_number(tjson_object_get(json, "version"));
+    int count;
+    double *numbers = tjson_array_numbers(items, &count);
+
+    /* frozen number arrays stay packed and can still be walked */
+    check(numbers && count == 8 && numbers[7] == version + 7, "packed numbers of a frozen array");
+    check(tjson_to_number(tjson_array_get(items, i % 8)) == version + i % 8, "element of a frozen packed array");
+    check(tjson_is_frozen(tjson_get_child(items)), "frozen element nodes");
+    tjson_shared_release(shared);
+    i++;
+  }
+  __atomic_add_fetch(&readers_done, 1, __ATOMIC_SEQ_CST);
+  tjson_pool_free();
+  return NULL;
+}
+
+static void test_slot(void) {
+  pthread_t threads[READERS];
+  int i;
+
+  slot = tjson_slot_create(make_version(0));
+  for (i = 0; i < READERS; i++) pthread_create(&threads[i], NULL, slot_reader, NULL);
+  /* readers never stop acquiring, publish must still get through */
+  for (i = 1; i <= 500 || __atomic_load_n(&readers_done, __ATOMIC_SEQ_CST) < READERS; i++)
+    tjson_slot_publish(slot, make_version(i));
+  for (i = 0; i < READERS; i++) pthread_join(threads[i], NULL);
+  tjson_slot_destroy(slot);
+}
+
+#define CACHE_FILES 4
+
+static tjson_cache_t *cache;
+
+static void write_file(const char *path, const char *text) {
+  FILE *fp = fopen(path, "w");
+  fputs(text, fp);
+  fclose(fp);
+}
+
+static void cache_path(char *path, int file) {
+  sprintf(path, "test_threads_%d.json", file);
+}
+
+static void *cache_reader(void *arg) {
+  int seed = *(int *)arg;
+  int i;
+  for (i = 0; i < 400; i++) {
+    char path[64];
+    int file = (seed + i * 7) % CACHE_FILES;
+    cache_path(path, file);
+    tjson_shared_t *shared = tjson_cache_open(cache, path);
+    tjson_t *json = tjson_shared_get(shared);
+    int count;
+    double *numbers = tjson_array_numbers(tjson_object_get(json, "items"), &count);
+    check(tjson_to_number(tjson_object_get(json, "file")) == file, "cached document of the right file");
+    check(numbers && count == 64 && numbers[63] == file + 63, "cached number array");
+    tjson_shared_release(shared);
+  }
+  tjson_pool_free();
+  return NULL;
+}
+
+/* misses parse outside the cache lock, on several threads at once */
+static void test_cache(void) {
+  pthread_t threads[READERS];
+  int seeds[READERS];
+  char path[64];
+  char text[1024];
+  int i, j;
+
+  for (i = 0; i < CACHE_FILES; i++) {
+    size_t len = sprintf(text, "{\"file\": %d, \"items\": [", i);
+    for (j = 0; j < 64; j++) len += sprintf(text + len, j ? ", %d" : "%d", i + j);
+    sprintf(text + len, "]}");
+    cache_path(path, i);
+    write_file(path, text);
+  }
+
+  /* room for about two of the files, so they keep being parsed again */
+  cache = tjson_cache_create(1600);
+  for (i = 0; i < READERS; i++) {
+    seeds[i] = i;
+    pthread_create(&threads[i], NULL, cache_reader, &seeds[i]);
+  }
+  for (i = 0; i < READERS; i++) pthread_join(threads[i], NULL);
+
+  /* same size, inode and second, only the sub-second mtime changes */
+  cache_path(path, 0);
+  write_file(path, "{\"v\": 1}");
+  tjson_shared_t *before = tjson_cache_open(cache, path);
+  write_file(path, "{\"v\": 2}");
+  tjson_shared_t *after = tjson_cache_open(cache, path);
+  check(tjson_to_number(tjson_object_get(tjson_shared_get(after), "v")) == 2, "file rewritten within a second");
+  tjson_shared_release(before);
+  tjson_shared_release(after);
+
+  tjson_cache_destroy(cache);
+  for (i = 0; i < CACHE_FILES; i++) {
+    cache_path(path, i);
+    remove(path);
+  }
+}
+
+int main(void) {
+  test_slot();
+  test_cache();
+  tjson_pool_free();
+  if (failures) {
+    fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  puts("threads: ok");
+  return 0;
+}
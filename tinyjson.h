@@ -1,6 +1,8 @@
 #ifndef _TINYJSON_H_
 #define _TINYJSON_H_
 
+#include <stddef.h>
+
 #define TJSON_API
 #define TJSON_NUMBER_ERROR -25215910
 
@@ -19,8 +21,30 @@ typedef struct tjson_s tjson_t;
 extern "C" {
 #endif
 
+/*=================*
+ *    Allocator    *
+ *=================*/
+
+/* Replace the functions used for every allocation (nodes, strings, buffers).
+ * Passing NULL restores the stdlib ones. Set it before creating any node. */
+TJSON_API void tjson_set_allocator(void* (*malloc_fn)(size_t), void* (*realloc_fn)(void*, size_t), void (*free_fn)(void*));
+/* Release the calling thread's node pool, call it before the thread exits.
+ * Its blocks are freed now if all of their nodes were deleted, otherwise by
+ * the last delete, from whichever thread. Nodes may be deleted anywhere. */
+TJSON_API void tjson_pool_free(void);
+/* Free buffers handed out by the library (tjson_encode) */
+TJSON_API void tjson_free(void* ptr);
+
+/* With TJSON_READ_ASYNC defined (and -pthread) large files are parsed while
+ * they are still being read. */
 TJSON_API tjson_t* tjson_open(const char* filename);
 TJSON_API tjson_t* tjson_parse(const char* json_str);
+/* Parse json_str into 'json', reusing its nodes and string/array buffers.
+ * Returns 'json' (NULL creates a new tree); with inputs of a similar shape
+ * it allocates nothing. */
+TJSON_API tjson_t* tjson_reparse(tjson_t* json, const char* json_str);
+/* Compact json text of the tree, free it with tjson_free. Strings are
+ * written the way the parser stores them, escape sequences untouched. */
 TJSON_API const char* tjson_print(tjson_t* json);
 TJSON_API int tjson_save(tjson_t* json, const char* filename);
 
@@ -41,6 +65,8 @@ TJSON_API tjson_t* tjson_get_next(tjson_t* json);
 
 TJSON_API void tjson_set_name(tjson_t* json, const char* name);
 TJSON_API const char* tjson_get_name(tjson_t* json);
+/* stored length, no strlen */
+TJSON_API int tjson_get_name_length(tjson_t* json);
 
 TJSON_API void tjson_set_number(tjson_t* json, double value);
 TJSON_API void tjson_set_string(tjson_t* json, const char* value);
@@ -48,6 +74,7 @@ TJSON_API void tjson_set_bool(tjson_t* json, int value);
 
 TJSON_API double tjson_to_number(tjson_t* json);
 TJSON_API const char* tjson_to_string(tjson_t* json);
+TJSON_API int tjson_to_string_length(tjson_t* json);
 TJSON_API int tjson_to_bool(tjson_t* json);
 
 /*=============*
@@ -59,6 +86,12 @@ TJSON_API tjson_t* tjson_array_get(tjson_t* array, int index);
 TJSON_API void tjson_array_push(tjson_t* array, tjson_t* value);
 TJSON_API tjson_t* tjson_array_pop(tjson_t* array);
 TJSON_API tjson_t* tjson_array_last(tjson_t* array);
+/* All-number arrays are stored as a packed buffer of doubles, nodes are only
+ * created when the array is walked through the generic API (tjson_array_get
+ * included, it returns a node); tjson_array_opt_number reads the buffer.
+ * Returns that buffer, or NULL once the array holds nodes (anything else
+ * than numbers, or after it was walked). */
+TJSON_API double* tjson_array_numbers(tjson_t* array, int* count);
 
 TJSON_API void tjson_array_set_number(tjson_t* array, int index, double value);
 TJSON_API void tjson_array_set_string(tjson_t* array, int index, const char* value);
@@ -115,6 +148,237 @@ TJSON_API tjson_t* tjson_object_opt_object(tjson_t *object, const char *name, tj
 #define tjson_object_get_array(object, name) tjson_object_opt_array(object, name, NULL)
 #define tjson_object_get_object(object, name) tjson_object_opt_object(object, name, NULL)
 
+/*===============*
+ *    Compare    *
+ *===============*/
+
+/* Deep copy; nodes come from the pool and strings are copied by length */
+TJSON_API tjson_t* tjson_clone(tjson_t* json);
+/* Structural hash and equality, object member order doesn't matter. Equal
+ * trees always hash the same, so a hash mismatch rules equality out. */
+TJSON_API unsigned int tjson_hash(tjson_t* json);
+TJSON_API int tjson_equal(tjson_t* a, tjson_t* b);
+
+/*=============*
+ *    Patch    *
+ *=============*/
+
+/* RFC 7386 merge patch applied in place: only the members named by 'patch'
+ * are visited. Returns the patched target, which is a new tree (and the old
+ * one deleted) when either side isn't an object. NULL if target is frozen. */
+TJSON_API tjson_t* tjson_merge_patch(tjson_t* target, tjson_t* patch);
+/* Smallest merge patch turning 'from' into 'to'. Like any merge patch it
+ * can't set a member to null, a null in 'to' removes the member. */
+TJSON_API tjson_t* tjson_merge_diff(tjson_t* from, tjson_t* to);
+
+/*==============*
+ *    Shared    *
+ *==============*/
+
+typedef struct tjson_shared_s tjson_shared_t;
+typedef struct tjson_slot_s tjson_slot_t;
+
+/* Freeze 'json' and hand it to a reference counted handle (count 1). A frozen
+ * tree rejects every change, so any number of threads can read it without
+ * locks; it is deleted when the last reference is released. */
+TJSON_API tjson_shared_t* tjson_share(tjson_t* json);
+TJSON_API tjson_shared_t* tjson_shared_retain(tjson_shared_t* shared);
+TJSON_API void tjson_shared_release(tjson_shared_t* shared);
+TJSON_API tjson_t* tjson_shared_get(tjson_shared_t* shared);
+TJSON_API int tjson_is_frozen(tjson_t* json);
+
+/* A slot holds the current version of a shared document. Readers acquire a
+ * reference without locking, publish swaps in a new version and releases the
+ * old one once no reader can still be picking it up; concurrent publishes
+ * take turns. Create and publish take over the caller's reference. */
+TJSON_API tjson_slot_t* tjson_slot_create(tjson_shared_t* shared);
+TJSON_API tjson_shared_t* tjson_slot_acquire(tjson_slot_t* slot);
+TJSON_API void tjson_slot_publish(tjson_slot_t* slot, tjson_shared_t* shared);
+TJSON_API void tjson_slot_destroy(tjson_slot_t* slot);
+
+/*=============*
+ *    Cache    *
+ *=============*/
+
+typedef struct tjson_cache_s tjson_cache_t;
+
+/* Parsed files kept as shared documents, least recently used ones are
+ * dropped past 'budget' bytes of trees. Safe to use from many threads. */
+TJSON_API tjson_cache_t* tjson_cache_create(size_t budget);
+TJSON_API void tjson_cache_destroy(tjson_cache_t* cache);
+/* Like tjson_open, but returns a reference to a frozen document, parsed
+ * again only when the file's size, mtime or inode changed. Release it with
+ * tjson_shared_release, it outlives its eviction from the cache. */
+TJSON_API tjson_shared_t* tjson_cache_open(tjson_cache_t* cache, const char* filename);
+/* Any of the outputs may be NULL */
+TJSON_API void tjson_cache_stats(tjson_cache_t* cache, unsigned long* hits, unsigned long* misses, size_t* bytes);
+
+/*===============*
+ *    Pointer    *
+ *===============*/
+
+typedef struct tjson_path_s tjson_path_t;
+
+/* RFC 6901 lookup, e.g. tjson_pointer_get(json, "/position/x") */
+TJSON_API tjson_t* tjson_pointer_get(tjson_t* json, const char* pointer);
+/* Number at the pointer, or 'opt'. Elements of packed number arrays are read
+ * in place, where tjson_pointer_get has to create the array's nodes. */
+TJSON_API double tjson_pointer_opt_number(tjson_t* json, const char* pointer, double opt);
+
+/* Decode a pointer once and evaluate it against many documents */
+TJSON_API tjson_path_t* tjson_path_compile(const char* pointer);
+TJSON_API tjson_t* tjson_path_get(tjson_path_t* path, tjson_t* json);
+TJSON_API double tjson_path_opt_number(tjson_path_t* path, tjson_t* json, double opt);
+TJSON_API void tjson_path_free(tjson_path_t* path);
+
+/* Single pass over json_str filling out[i] with a copy of the value at
+ * paths[i] (NULL when missing). Nodes are only built for matched values,
+ * everything else is skipped. Returns the number of matches, -1 on error. */
+TJSON_API int tjson_extract(const char* json_str, tjson_path_t** paths, int count, tjson_t** out);
+
+/*===============*
+ *    Binding    *
+ *===============*/
+
+typedef enum {
+    TJSON_BIND_END = 0,
+    TJSON_BIND_INT,     /* signed integer, any of char/short/int/long */
+    TJSON_BIND_FLOAT,
+    TJSON_BIND_DOUBLE,
+    TJSON_BIND_BOOL,    /* stored like TJSON_BIND_INT */
+    TJSON_BIND_STRING,  /* char*, allocated, see tjson_bind_free */
+    TJSON_BIND_CHARS,   /* char[N], truncated to fit */
+    TJSON_BIND_STRUCT   /* nested struct described by 'fields' */
+} TJSON_BIND_;
+
+#define TJSON_BIND_DYNAMIC -1
+
+typedef struct tjson_field_s tjson_field_t;
+
+struct tjson_field_s {
+    const char* key;
+    TJSON_BIND_ type;
+    size_t offset;
+    size_t size;          /* size of one element */
+    int count;            /* 0 scalar, N fixed array, TJSON_BIND_DYNAMIC pointer */
+    size_t count_offset;  /* int member receiving a dynamic array length */
+    const tjson_field_t* fields;
+};
+
+#define TJSON_MEMBER_SIZE(st, member) sizeof(((st*)0)->member)
+#define TJSON_MEMBER_COUNT(st, member) (int)(sizeof(((st*)0)->member) / sizeof(((st*)0)->member[0]))
+
+#define TJSON_FIELD(key, type, st, member) \
+    { key, type, offsetof(st, member), TJSON_MEMBER_SIZE(st, member), 0, 0, NULL }
+#define TJSON_FIELD_ARRAY(key, type, st, member) \
+    { key, type, offsetof(st, member), TJSON_MEMBER_SIZE(st, member[0]), TJSON_MEMBER_COUNT(st, member), 0, NULL }
+#define TJSON_FIELD_VECTOR(key, type, st, member, count_member) \
+    { key, type, offsetof(st, member), TJSON_MEMBER_SIZE(st, member[0]), TJSON_BIND_DYNAMIC, offsetof(st, count_member), NULL }
+#define TJSON_FIELD_STRUCT(key, st, member, fields) \
+    { key, TJSON_BIND_STRUCT, offsetof(st, member), TJSON_MEMBER_SIZE(st, member), 0, 0, fields }
+#define TJSON_FIELD_STRUCT_ARRAY(key, st, member, fields) \
+    { key, TJSON_BIND_STRUCT, offsetof(st, member), TJSON_MEMBER_SIZE(st, member[0]), TJSON_MEMBER_COUNT(st, member), 0, fields }
+#define TJSON_FIELD_STRUCT_VECTOR(key, st, member, count_member, fields) \
+    { key, TJSON_BIND_STRUCT, offsetof(st, member), TJSON_MEMBER_SIZE(st, member[0]), TJSON_BIND_DYNAMIC, offsetof(st, count_member), fields }
+#define TJSON_FIELD_END { NULL, TJSON_BIND_END, 0, 0, 0, 0, NULL }
+
+/* Fill the struct 'out' straight from the tokens of a json object, no
+ * tree is built. Unknown keys and mismatched types are skipped, missing
+ * keys leave their member untouched. Strings and dynamic arrays already in
+ * 'out' are freed when replaced, so it must start zeroed (or hold a
+ * previous bind). Returns 0, or -1 on error, when 'out' may be partly
+ * filled: tjson_bind_free releases it either way. */
+TJSON_API int tjson_bind(const char* json_str, const tjson_field_t* fields, void* out);
+TJSON_API int tjson_bind_file(const char* filename, const tjson_field_t* fields, void* out);
+/* Free the strings and dynamic arrays allocated by tjson_bind */
+TJSON_API void tjson_bind_free(const tjson_field_t* fields, void* out);
+
+/*==============*
+ *    Binary    *
+ *==============*/
+
+/* Native binary image of a tree: a deduplicated string table followed by the
+ * values in pre-order, integers and lengths as varints, so loading needs no
+ * tokenizing or strtod. Doubles use host byte order, images from another one
+ * are rejected. */
+TJSON_API void* tjson_encode(tjson_t* json, size_t* size);
+TJSON_API tjson_t* tjson_decode(const void* data, size_t size);
+TJSON_API int tjson_save_binary(tjson_t* json, const char* filename);
+TJSON_API tjson_t* tjson_open_binary(const char* filename);
+
+/* Cursor on one value of an image, read in place without building a tree.
+ * Valid as long as the image memory is, which must be 8 byte aligned. Every
+ * read is bounds checked, a corrupted image gives 0/NULL results. */
+typedef struct {
+    const unsigned char* image;
+    const unsigned char* at;  /* payload of the value */
+    const unsigned char* end; /* end of the value and its next siblings */
+    const char* name;         /* member name, NULL outside objects */
+    int kind;                 /* encoding of the value */
+    int parent;               /* encoding of the enclosing container */
+} tjson_view_t;
+
+/* Returns 0 and points 'root' at the top value, -1 if the image is invalid */
+TJSON_API int tjson_view_open(tjson_view_t* root, const void* data, size_t size);
+TJSON_API TJSON_TYPE_ tjson_view_type(const tjson_view_t* view);
+TJSON_API const char* tjson_view_name(const tjson_view_t* view);
+/* TJSON_NUMBER_ERROR when the value isn't a number */
+TJSON_API double tjson_view_number(const tjson_view_t* view);
+TJSON_API int tjson_view_bool(const tjson_view_t* view);
+TJSON_API const char* tjson_view_string(const tjson_view_t* view, int* length);
+TJSON_API int tjson_view_count(const tjson_view_t* view);
+/* These return 1 when 'out' (or 'view' for next) was moved, 0 otherwise */
+TJSON_API int tjson_view_child(const tjson_view_t* view, tjson_view_t* out);
+TJSON_API int tjson_view_next(tjson_view_t* view);
+TJSON_API int tjson_view_get(const tjson_view_t* object, const char* name, tjson_view_t* out);
+TJSON_API int tjson_view_at(const tjson_view_t* array, int index, tjson_view_t* out);
+/* The doubles of a number array stored unpacked in the image, NULL for other
+ * values and for arrays of integers, which are stored as varints */
+TJSON_API const double* tjson_view_numbers(const tjson_view_t* array, int* count);
+/* Build a tree of the value and everything under it */
+TJSON_API tjson_t* tjson_view_decode(const tjson_view_t* view);
+
+/* Map an image file read-only (or read it where mmap isn't available) and
+ * point 'root' at its top value. The views die with tjson_unmap_binary. */
+typedef struct tjson_mapping_s tjson_mapping_t;
+TJSON_API tjson_mapping_t* tjson_map_binary(const char* filename, tjson_view_t* root);
+TJSON_API void tjson_unmap_binary(tjson_mapping_t* mapping);
+
+/*=============*
+ *    Stats    *
+ *=============*/
+
+/* Parse instrumentation, only compiled with TJSON_STATS defined (for the
+ * implementation and its users); without it none of this exists. */
+#if defined(TJSON_STATS)
+typedef enum {
+    TJSON_PHASE_LINK = 0,   /* parser glue, linking values into the tree */
+    TJSON_PHASE_SCAN,       /* s_scan_token */
+    TJSON_PHASE_NUMBER,     /* number conversion */
+    TJSON_PHASE_STRING,     /* copying string values and member names */
+    TJSON_PHASE_NODE,       /* tjson_create, or recycling for tjson_reparse */
+    TJSON_PHASE_COUNT
+} TJSON_PHASE_;
+
+#define TJSON_STATS_TOKENS 16
+
+typedef struct {
+    unsigned long tokens[TJSON_STATS_TOKENS]; /* by token type, see tjson_stats_token_name */
+    unsigned long nodes;
+    unsigned long string_bytes;
+    unsigned long allocs;         /* allocator calls, the node pool calls it once per block */
+    unsigned long alloc_bytes;
+    int max_depth;
+    unsigned long long cycles[TJSON_PHASE_COUNT]; /* exclusive, in TJSON_CYCLES() ticks */
+} tjson_stats_t;
+
+/* Counters of the last parse, extract or bind on the calling thread,
+ * allocations keep counting until the next one starts. */
+TJSON_API const tjson_stats_t* tjson_get_stats(void);
+TJSON_API const char* tjson_stats_token_name(int type);
+TJSON_API const char* tjson_stats_phase_name(int phase);
+#endif
+
 #if defined(__cplusplus)
 }
 #endif
@@ -131,6 +395,7 @@ TJSON_API tjson_t* tjson_object_opt_object(tjson_t *object, const char *name, tj
 typedef struct tjson_scanner_s tjson_scanner_t;
 typedef struct tjson_token_s tjson_token_t;
 typedef struct tjson_parser_s tjson_parser_t;
+typedef struct tjson_stream_s tjson_stream_t;
 
 typedef enum {
   TJSON_TOKEN_NULL = 0,   /* Null token                 'null'   */
@@ -155,6 +420,7 @@ struct tjson_scanner_s {
     const char* start;
     const char* current;
     int line;
+    tjson_stream_t* stream;
 };
 
 struct tjson_token_s {
@@ -169,37 +435,396 @@ struct tjson_parser_s {
     tjson_token_t previous;
     int hand_error;
     int panic_mode;
+    tjson_t* recycle;
 };
 
-static tjson_scanner_t scanner;
-static tjson_parser_t parser;
+#define TJSON_FLAG_PACKED 1
+#define TJSON_FLAG_FROZEN 2
+
+typedef struct {
+    int count;
+    int capacity;
+    tjson_t* nodes;     /* element nodes of a frozen array, see s_array_child */
+} tjson_packed_t;
+
+#define TJSON_PACKED_DATA(packed) ((double*)((packed) + 1))
 
 struct tjson_s {
     int type;
+    int flags;
     char* name;
     union {
         char* string;
         double number;
         int boolean;
         tjson_t* child;
+        tjson_packed_t* packed;
     };
 
     tjson_t* next;
 };
 
+#if !defined(TJSON_TLS)
+#if defined(TJSON_NO_TLS)
+#define TJSON_TLS
+#elif defined(_MSC_VER)
+#define TJSON_TLS __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define TJSON_TLS __thread
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define TJSON_TLS _Thread_local
+#else
+#define TJSON_TLS
+#endif
+#endif
+
+/* per thread, so threads can parse (and fill the cache) at the same time */
+static TJSON_TLS tjson_scanner_t scanner;
+static TJSON_TLS tjson_parser_t parser;
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TJSON_ATOMIC_INC(ptr) _InterlockedIncrement(ptr)
+#define TJSON_ATOMIC_DEC(ptr) _InterlockedDecrement(ptr)
+#define TJSON_ATOMIC_ADD(ptr, value) (_InterlockedExchangeAdd(ptr, value) + (value))
+#define TJSON_ATOMIC_LOAD(ptr) _InterlockedOr(ptr, 0)
+#define TJSON_ATOMIC_LOAD_PTR(ptr) _InterlockedCompareExchangePointer((void* volatile*)(ptr), NULL, NULL)
+#define TJSON_ATOMIC_XCHG_PTR(ptr, value) _InterlockedExchangePointer((void* volatile*)(ptr), value)
+#define TJSON_ATOMIC_CAS_PTR(ptr, expected, value) \
+    (_InterlockedCompareExchangePointer((void* volatile*)(ptr), value, expected) == (void*)(expected))
+#define TJSON_ATOMIC_XCHG(ptr, value) _InterlockedExchange(ptr, value)
+#else
+#define TJSON_ATOMIC_INC(ptr) __atomic_add_fetch(ptr, 1, __ATOMIC_SEQ_CST)
+#define TJSON_ATOMIC_DEC(ptr) __atomic_sub_fetch(ptr, 1, __ATOMIC_SEQ_CST)
+#define TJSON_ATOMIC_ADD(ptr, value) __atomic_add_fetch(ptr, value, __ATOMIC_SEQ_CST)
+#define TJSON_ATOMIC_LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_SEQ_CST)
+#define TJSON_ATOMIC_LOAD_PTR(ptr) __atomic_load_n(ptr, __ATOMIC_SEQ_CST)
+#define TJSON_ATOMIC_XCHG_PTR(ptr, value) __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST)
+#define TJSON_ATOMIC_CAS_PTR(ptr, expected, value) __sync_bool_compare_and_swap(ptr, expected, value)
+#define TJSON_ATOMIC_XCHG(ptr, value) __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST)
+#endif
+
+/* TJSON_READ_ASYNC: tjson_open parses big files while a thread reads them
+ * in TJSON_READ_CHUNK pieces. Needs pthreads, elsewhere files are read
+ * whole as usual. */
+#if defined(TJSON_READ_ASYNC) && !defined(_WIN32)
+#define TJSON_READ_STREAM
+#endif
+
+#if !defined(TJSON_READ_CHUNK)
+#define TJSON_READ_CHUNK (256 << 10)
+#endif
+
+#if !defined(TJSON_READ_BUFFERS)
+#define TJSON_READ_BUFFERS 2
+#endif
+
+/*=============*
+ *    Stats    *
+ *=============*/
+
+#if defined(TJSON_STATS)
+#if !defined(TJSON_CYCLES)
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define TJSON_CYCLES() __rdtsc()
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define TJSON_CYCLES() __rdtsc()
+#else
+#include <time.h>
+#define TJSON_CYCLES() ((unsigned long long)clock())
+#endif
+#endif
+
+static TJSON_TLS tjson_stats_t s_stats;
+static TJSON_TLS int s_stats_phase_current;
+static TJSON_TLS unsigned long long s_stats_mark;
+static TJSON_TLS int s_stats_depth;
+
+/* charges the ticks since the last switch to the phase being left, so
+ * nested phases aren't counted twice. Returns that phase. */
+static int s_stats_phase(int phase) {
+    unsigned long long now = TJSON_CYCLES();
+    int previous = s_stats_phase_current;
+    s_stats.cycles[previous] += now - s_stats_mark;
+    s_stats_mark = now;
+    s_stats_phase_current = phase;
+    return previous;
+}
+
+static void s_stats_begin(void) {
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats_phase_current = TJSON_PHASE_LINK;
+    s_stats_depth = 0;
+    s_stats_mark = TJSON_CYCLES();
+}
+
+#define TJSON_STATS_BEGIN() s_stats_begin()
+#define TJSON_STATS_ADD(field, n) (s_stats.field += (n))
+#define TJSON_STATS_PHASE(saved, phase) int saved = s_stats_phase(phase)
+#define TJSON_STATS_PHASE_END(saved) s_stats_phase(saved)
+#define TJSON_STATS_ENTER() if (++s_stats_depth > s_stats.max_depth) s_stats.max_depth = s_stats_depth
+#define TJSON_STATS_LEAVE() (s_stats_depth--)
+
+const tjson_stats_t* tjson_get_stats(void) { return &s_stats; }
+
+const char* tjson_stats_token_name(int type) {
+    static const char* names[TJSON_STATS_TOKENS] = {
+        "null", "false", "true", "number", "string", "lbrace", "rbrace", "lsquar",
+        "rsquar", "comma", "dot", "minus", "colon", "identifier", "error", "eof"
+    };
+    return type >= 0 && type < TJSON_STATS_TOKENS ? names[type] : NULL;
+}
+
+const char* tjson_stats_phase_name(int phase) {
+    static const char* names[TJSON_PHASE_COUNT] = { "link", "scan", "number", "string", "node" };
+    return phase >= 0 && phase < TJSON_PHASE_COUNT ? names[phase] : NULL;
+}
+#else
+#define TJSON_STATS_BEGIN()
+#define TJSON_STATS_ADD(field, n)
+#define TJSON_STATS_PHASE(saved, phase)
+#define TJSON_STATS_PHASE_END(saved)
+#define TJSON_STATS_ENTER()
+#define TJSON_STATS_LEAVE()
+#endif
+
+/*=================*
+ *    Allocator    *
+ *=================*/
+
+#if !defined(TJSON_POOL_BLOCK)
+#define TJSON_POOL_BLOCK 256
+#endif
+
+static void* (*s_malloc_fn)(size_t) = malloc;
+static void* (*s_realloc_fn)(void*, size_t) = realloc;
+static void (*s_free_fn)(void*) = free;
+
+static void* s_malloc(size_t size) {
+    TJSON_STATS_ADD(allocs, 1);
+    TJSON_STATS_ADD(alloc_bytes, size);
+    return s_malloc_fn(size);
+}
+
+static void* s_realloc(void* ptr, size_t size) {
+    TJSON_STATS_ADD(allocs, 1);
+    TJSON_STATS_ADD(alloc_bytes, size);
+    return s_realloc_fn(ptr, size);
+}
+static void s_free(void* ptr) { if (ptr) s_free_fn(ptr); }
+
+static char* s_strdup(const char* str, size_t len) {
+    char* dup = (char*)s_malloc(len+1);
+    if (!dup) return NULL;
+    memcpy(dup, str, len);
+    dup[len] = '\0';
+    return dup;
+}
+
+/* Node names and strings keep their length and capacity in front of the
+ * characters, so they can be measured and overwritten without strlen or a
+ * new allocation. */
+typedef struct {
+    int length;
+    int capacity;
+} tjson_string_t;
+
+#define TJSON_STRING_HEADER(str) ((tjson_string_t*)(str) - 1)
+
+static char* s_str_assign(char* str, const char* value, int len) {
+    tjson_string_t* header = str ? TJSON_STRING_HEADER(str) : NULL;
+    if (!header || header->capacity < len) {
+        tjson_string_t* resized = (tjson_string_t*)s_realloc(header, sizeof(*header) + len + 1);
+        if (!resized) return str;
+        header = resized;
+        header->capacity = len;
+    }
+    header->length = len;
+    str = (char*)(header + 1);
+    memmove(str, value, len);
+    str[len] = '\0';
+    return str;
+}
+
+static int s_str_len(const char* str) { return TJSON_STRING_HEADER(str)->length; }
+
+static void s_str_free(char* str) {
+    if (str) s_free(TJSON_STRING_HEADER(str));
+}
+
+#if !defined(TJSON_NO_POOL)
+/* Nodes are carved from fixed size blocks owned by the creating thread's
+ * pool. A node keeps its slot in the block in the upper bits of 'flags', so
+ * a delete finds the owner: the owner's own deletes go to its free list,
+ * other threads push to the pool's 'remote' list, which the owner takes
+ * over once its free list is empty. */
+typedef struct tjson_pool_s tjson_pool_t;
+typedef struct tjson_pool_block_s tjson_pool_block_t;
+
+struct tjson_pool_block_s {
+    tjson_pool_t* pool;
+    tjson_pool_block_t* next;
+    tjson_t nodes[TJSON_POOL_BLOCK];
+};
+
+struct tjson_pool_s {
+    tjson_pool_block_t* blocks;
+    tjson_t* free_list;
+    int used;
+    long live;          /* created minus deleted by the owner */
+    tjson_t* remote;
+    long balance;       /* minus the deletes by other threads, plus 'live' once released */
+};
+
+static TJSON_TLS tjson_pool_t* s_pool;
+
+#define TJSON_SLOT_SHIFT 8
+#define TJSON_NODE_BLOCK(node) \
+    ((tjson_pool_block_t*)((char*)((node) - ((unsigned int)(node)->flags >> TJSON_SLOT_SHIFT)) - offsetof(tjson_pool_block_t, nodes)))
+
+static void s_pool_destroy(tjson_pool_t* pool) {
+    tjson_pool_block_t* block = pool->blocks;
+    while (block) {
+        tjson_pool_block_t* next = block->next;
+        s_free(block);
+        block = next;
+    }
+    s_free(pool);
+}
+#endif
+
+/* returns a zeroed node */
+static tjson_t* s_node_alloc(void) {
+#if !defined(TJSON_NO_POOL)
+    tjson_pool_t* pool = s_pool;
+    if (!pool) {
+        pool = (tjson_pool_t*)s_malloc(sizeof(*pool));
+        if (!pool) return NULL;
+        memset(pool, 0, sizeof(*pool));
+        s_pool = pool;
+    }
+
+    tjson_t* node = pool->free_list;
+    if (!node && TJSON_ATOMIC_LOAD_PTR(&pool->remote)) node = (tjson_t*)TJSON_ATOMIC_XCHG_PTR(&pool->remote, NULL);
+    int slot;
+    if (node) {
+        pool->free_list = node->next;
+        slot = (unsigned int)node->flags >> TJSON_SLOT_SHIFT;
+    } else {
+        if (!pool->blocks || pool->used == TJSON_POOL_BLOCK) {
+            tjson_pool_block_t* block = (tjson_pool_block_t*)s_malloc(sizeof(*block));
+            if (!block) return NULL;
+            block->pool = pool;
+            block->next = pool->blocks;
+            pool->blocks = block;
+            pool->used = 0;
+        }
+        slot = pool->used++;
+        node = &pool->blocks->nodes[slot];
+    }
+    pool->live++;
+    memset(node, 0, sizeof(*node));
+    node->flags = slot << TJSON_SLOT_SHIFT;
+    return node;
+#else
+    tjson_t* node = (tjson_t*)s_malloc(sizeof(tjson_t));
+    if (node) memset(node, 0, sizeof(*node));
+    return node;
+#endif
+}
+
+static void s_node_free(tjson_t* node) {
+#if !defined(TJSON_NO_POOL)
+    tjson_pool_t* pool = TJSON_NODE_BLOCK(node)->pool;
+    if (pool == s_pool) {
+        node->next = pool->free_list;
+        pool->free_list = node;
+        pool->live--;
+        return;
+    }
+
+    tjson_t* head;
+    do {
+        head = (tjson_t*)TJSON_ATOMIC_LOAD_PTR(&pool->remote);
+        node->next = head;
+    } while (!TJSON_ATOMIC_CAS_PTR(&pool->remote, head, node));
+    /* only reaches 0 after the owner released the pool */
+    if (TJSON_ATOMIC_ADD(&pool->balance, -1) == 0) s_pool_destroy(pool);
+#else
+    s_free(node);
+#endif
+}
+
+void tjson_set_allocator(void* (*malloc_fn)(size_t), void* (*realloc_fn)(void*, size_t), void (*free_fn)(void*)) {
+    s_malloc_fn = malloc_fn ? malloc_fn : malloc;
+    s_realloc_fn = realloc_fn ? realloc_fn : realloc;
+    s_free_fn = free_fn ? free_fn : free;
+}
+
+void tjson_free(void* ptr) { s_free(ptr); }
+
+void tjson_pool_free(void) {
+#if !defined(TJSON_NO_POOL)
+    tjson_pool_t* pool = s_pool;
+    if (!pool) return;
+    s_pool = NULL;
+    /* the blocks go now, or with the last of their nodes wherever it is deleted */
+    if (TJSON_ATOMIC_ADD(&pool->balance, pool->live) == 0) s_pool_destroy(pool);
+#endif
+}
+
 
 /* scanner */
 static tjson_t* s_parse_json(const char* json_str);
+static void s_recycle_collect(tjson_t* json, tjson_t*** tail);
 
 /* utils */
 static char* s_file_read(const char* filename);
+static char* s_file_read_size(const char* filename, size_t* size);
+#if defined(TJSON_READ_STREAM)
+static int s_open_stream(const char* filename, tjson_t** out);
+#endif
 
 tjson_t* tjson_parse(const char* json_str) { return s_parse_json(json_str); }
 
+tjson_t* tjson_reparse(tjson_t* json, const char* json_str) {
+    if (!json) return tjson_parse(json_str);
+    if (!json_str || json->flags & TJSON_FLAG_FROZEN) return NULL;
+
+    /* the root is queued first, so it is also the first node handed out;
+     * a member keeps its name and its later siblings */
+    char* name = json->name;
+    tjson_t* next = json->next;
+    json->name = NULL;
+    tjson_t** tail = &parser.recycle;
+    s_recycle_collect(json, &tail);
+
+    tjson_t* root = s_parse_json(json_str);
+    if (root) {
+        root->name = name;
+        root->next = next;
+    } else s_str_free(name);
+
+    while (parser.recycle) {
+        tjson_t* next = parser.recycle->next;
+        parser.recycle->next = NULL;
+        tjson_delete(parser.recycle);
+        parser.recycle = next;
+    }
+    return root;
+}
+
 tjson_t* tjson_open(const char* filename) {
+#if defined(TJSON_READ_STREAM)
+    tjson_t* streamed = NULL;
+    if (s_open_stream(filename, &streamed)) return streamed;
+#endif
     const char* source = s_file_read(filename);
+    if (!source) return NULL;
     tjson_t* json = tjson_parse(source);
-    free((void*)source);
+    s_free((void*)source);
     return json;
 }
 
@@ -208,20 +833,27 @@ tjson_t* tjson_create(TJSON_TYPE_ type) {
         fprintf(stderr, "Invalid object type\n");
         return NULL;
     }
-    tjson_t* json = (tjson_t*)malloc(sizeof(*json));
+    tjson_t* json = s_node_alloc();
     if (!json) return NULL;
-    memset(json, 0, sizeof(*json));
-
-    json->name = NULL;
     json->type = type;
-    json->next = NULL;
-    json->child = NULL;
     return json;
 }
 
 void tjson_clear(tjson_t* json) {
-    if (!json) return;
+    if (!json || json->flags & TJSON_FLAG_FROZEN) return;
     if (json->type != TJSON_OBJECT && json->type != TJSON_ARRAY) return;
+    if (json->flags & TJSON_FLAG_PACKED) {
+        tjson_t* iter = json->packed->nodes;
+        while (iter) {
+            tjson_t* next = iter->next;
+            tjson_delete(iter);
+            iter = next;
+        }
+        s_free(json->packed);
+        json->flags &= ~TJSON_FLAG_PACKED;
+        json->child = NULL;
+        return;
+    }
 
     tjson_t* iter = json->child;
     while (iter) {
@@ -229,13 +861,15 @@ void tjson_clear(tjson_t* json) {
         tjson_delete(iter);
         iter = next;
     }
+    json->child = NULL;
 }
 
 void tjson_delete(tjson_t* json) {
-    if (!json) return;
+    if (!json || json->flags & TJSON_FLAG_FROZEN) return;
     tjson_clear(json);
-    if (json->type == TJSON_STRING && json->string) free(json->string);
-    free(json);
+    if (json->type == TJSON_STRING) s_str_free(json->string);
+    s_str_free(json->name);
+    s_node_free(json);
 }
 
 tjson_t* tjson_create_null() { return tjson_create(TJSON_NULL); }
@@ -249,9 +883,7 @@ tjson_t* tjson_create_number(double value) {
 tjson_t* tjson_create_string(const char* value) {
     if (!value) return NULL;
     tjson_t* json = tjson_create(TJSON_STRING);
-    int size = strlen(value);
-    json->string = (char*)malloc(size+1);
-    strcpy(json->string, value);
+    json->string = s_str_assign(NULL, value, strlen(value));
     return json;
 }
 
@@ -265,9 +897,11 @@ tjson_t* tjson_create_array() { return tjson_create(TJSON_ARRAY); }
 
 tjson_t* tjson_create_object() { return tjson_create(TJSON_OBJECT); }
 
+static tjson_t* s_array_child(tjson_t* array);
+
 tjson_t* tjson_get_child(tjson_t* json) {
     if (!json) return NULL;
-    return json->child;
+    return s_array_child(json);
 }
 
 tjson_t* tjson_get_next(tjson_t* json) {
@@ -281,16 +915,8 @@ TJSON_TYPE_ tjson_get_type(tjson_t* json) {
 }
 
 void tjson_set_name(tjson_t* json, const char* name) {
-    if (!json) return;
-    int len = strlen(name);
-    if (!json->name) {
-        json->name = malloc(len + 1);
-    } else {
-        int name_len = strlen(json->name);
-        if (name_len < len) json->name = realloc(json->name, len+1);
-    }
-    strcpy(json->name, name);
-    json->name[len] = '\0';
+    if (!json || json->flags & TJSON_FLAG_FROZEN) return;
+    json->name = s_str_assign(json->name, name, strlen(name));
 }
 
 const char* tjson_get_name(tjson_t* json) {
@@ -298,24 +924,24 @@ const char* tjson_get_name(tjson_t* json) {
     return (const char*)json->name;
 }
 
+int tjson_get_name_length(tjson_t* json) {
+    if (!json || !json->name) return 0;
+    return s_str_len(json->name);
+}
+
 void tjson_set_number(tjson_t* json, double value) {
-    if (!json || json->type != TJSON_NUMBER) return;
+    if (!json || json->type != TJSON_NUMBER || json->flags & TJSON_FLAG_FROZEN) return;
     json->number = value;
 }
 
 void tjson_set_string(tjson_t* json, const char* value) {
-    if (!json || json->type != TJSON_STRING) return;
+    if (!json || json->type != TJSON_STRING || json->flags & TJSON_FLAG_FROZEN) return;
     if (!value) return;
-    int len = strlen(value);
-    if (len > strlen(json->string)) {
-        json->string = realloc(json->string, len+1);
-    }
-    memcpy(json->string, value, len);
-    json->string[len] = '\0';
+    json->string = s_str_assign(json->string, value, strlen(value));
 }
 
 void tjson_set_bool(tjson_t* json, int value) {
-    if (!json || json->type != TJSON_BOOL) return;
+    if (!json || json->type != TJSON_BOOL || json->flags & TJSON_FLAG_FROZEN) return;
     json->boolean = value;
 }
 
@@ -329,8 +955,13 @@ const char* tjson_to_string(tjson_t* json) {
     return json->string;
 }
 
+int tjson_to_string_length(tjson_t* json) {
+    if (!json || json->type != TJSON_STRING || !json->string) return 0;
+    return s_str_len(json->string);
+}
+
 int tjson_to_bool(tjson_t* json) {
-    if (!json || json->type != TJSON_NUMBER) return TJSON_NUMBER_ERROR;
+    if (!json || json->type != TJSON_BOOL) return TJSON_NUMBER_ERROR;
     return json->boolean;
 }
 
@@ -338,9 +969,101 @@ int tjson_to_bool(tjson_t* json) {
  *    Array    *
  *=============*/
 
+static tjson_packed_t* s_packed_reserve(tjson_t* array, int count) {
+    tjson_packed_t* packed = (array->flags & TJSON_FLAG_PACKED) ? array->packed : NULL;
+    int capacity = packed ? packed->capacity : 0;
+    if (count <= capacity) return packed;
+    if (capacity < 8) capacity = 8;
+    while (capacity < count) capacity *= 2;
+
+    tjson_packed_t* resized = (tjson_packed_t*)s_realloc(packed, sizeof(*packed) + capacity * sizeof(double));
+    if (!resized) return NULL;
+    if (!packed) {
+        resized->count = 0;
+        resized->nodes = NULL;
+    }
+    resized->capacity = capacity;
+    array->packed = resized;
+    array->flags |= TJSON_FLAG_PACKED;
+    return resized;
+}
+
+static int s_packed_push(tjson_t* array, double value) {
+    int count = (array->flags & TJSON_FLAG_PACKED) ? array->packed->count : 0;
+    tjson_packed_t* packed = s_packed_reserve(array, count + 1);
+    if (!packed) return 0;
+    TJSON_PACKED_DATA(packed)[packed->count++] = value;
+    return 1;
+}
+
+static tjson_t* s_packed_build(tjson_packed_t* packed) {
+    double* numbers = TJSON_PACKED_DATA(packed);
+    tjson_t* first = NULL;
+    tjson_t* last = NULL;
+    int i;
+    for (i = 0; i < packed->count; i++) {
+        tjson_t* number = tjson_create_number(numbers[i]);
+        if (!number) break;
+        if (last) last->next = number;
+        else first = number;
+        last = number;
+    }
+    return first;
+}
+
+/* turns a packed array back into number nodes, frozen arrays stay packed */
+static void s_array_unpack(tjson_t* array) {
+    if (!(array->flags & TJSON_FLAG_PACKED) || array->flags & TJSON_FLAG_FROZEN) return;
+
+    tjson_packed_t* packed = array->packed;
+    array->flags &= ~TJSON_FLAG_PACKED;
+    array->child = s_packed_build(packed);
+    s_free(packed);
+}
+
+/* First node of the children. A frozen packed array is never touched: the
+ * first reader builds frozen element nodes next to the numbers and publishes
+ * them once, a reader losing that race drops its own copy. */
+static tjson_t* s_array_child(tjson_t* array) {
+    if (!(array->flags & TJSON_FLAG_PACKED)) return array->child;
+    if (!(array->flags & TJSON_FLAG_FROZEN)) {
+        s_array_unpack(array);
+        return array->child;
+    }
+
+    tjson_packed_t* packed = array->packed;
+    tjson_t* nodes = (tjson_t*)TJSON_ATOMIC_LOAD_PTR(&packed->nodes);
+    if (nodes || !packed->count) return nodes;
+
+    nodes = s_packed_build(packed);
+    tjson_t* el;
+    for (el = nodes; el; el = el->next) el->flags |= TJSON_FLAG_FROZEN;
+    if (TJSON_ATOMIC_CAS_PTR(&packed->nodes, NULL, nodes)) return nodes;
+
+    while (nodes) {
+        tjson_t* next = nodes->next;
+        nodes->flags &= ~TJSON_FLAG_FROZEN;
+        tjson_delete(nodes);
+        nodes = next;
+    }
+    return (tjson_t*)TJSON_ATOMIC_LOAD_PTR(&packed->nodes);
+}
+
+double* tjson_array_numbers(tjson_t* array, int* count) {
+    if (count) *count = 0;
+    if (!array || array->type != TJSON_ARRAY) return NULL;
+
+    /* element nodes the caller may hold are never folded back */
+    if (!(array->flags & TJSON_FLAG_PACKED)) return NULL;
+
+    if (count) *count = array->packed->count;
+    return TJSON_PACKED_DATA(array->packed);
+}
+
 tjson_t* tjson_array_set(tjson_t *array, int index, tjson_t *value) {
-    if (!array) return NULL;
+    if (!array || array->flags & TJSON_FLAG_FROZEN) return NULL;
     if (!value) return NULL;
+    s_array_unpack(array);
 
     tjson_t *iter = array->child;
     if (index < 0) index = 0;
@@ -366,7 +1089,7 @@ tjson_t* tjson_array_set(tjson_t *array, int index, tjson_t *value) {
 
 tjson_t* tjson_array_get(tjson_t *array, int index) {
     if (!array) return NULL;
-    tjson_t *iter = array->child;
+    tjson_t *iter = s_array_child(array);
     if (!iter) return NULL;
 
     int i = 0;
@@ -380,8 +1103,9 @@ tjson_t* tjson_array_get(tjson_t *array, int index) {
 }
 
 void tjson_array_push(tjson_t *array, tjson_t *value) {
-    if (!array) return;
+    if (!array || array->flags & TJSON_FLAG_FROZEN) return;
     if (!value) return;
+    s_array_unpack(array);
     tjson_t *iter = array->child;
     if (!iter) {
         array->child = value;
@@ -394,8 +1118,9 @@ void tjson_array_push(tjson_t *array, tjson_t *value) {
     value->next = NULL;
 }
 tjson_t* tjson_array_pop(tjson_t *array) {
-    if (!array) return NULL;
+    if (!array || array->flags & TJSON_FLAG_FROZEN) return NULL;
     if (array->type != TJSON_ARRAY && array->type != TJSON_OBJECT) return NULL;
+    s_array_unpack(array);
 
     tjson_t *iter = array->child;
     if (!iter) return NULL;
@@ -412,7 +1137,7 @@ tjson_t* tjson_array_pop(tjson_t *array) {
     return next;
 }
 tjson_t* tjson_array_last(tjson_t *array) {
-    tjson_t *iter = array->child;
+    tjson_t *iter = s_array_child(array);
     if (!iter) return NULL;
     while (iter->next) iter = iter->next;
 
@@ -446,6 +1171,10 @@ void tjson_array_set_object(tjson_t *array, int index, tjson_t *value) {
 }
 
 double tjson_array_opt_number(tjson_t *array, int index, double opt) {
+    if (array && array->flags & TJSON_FLAG_PACKED) {
+        tjson_packed_t *packed = array->packed;
+        return index >= 0 && index < packed->count ? TJSON_PACKED_DATA(packed)[index] : opt;
+    }
     tjson_t *number = tjson_array_get(array, index);
     if (!number) return opt;
     if (number->type != TJSON_NUMBER) return opt;
@@ -453,6 +1182,7 @@ double tjson_array_opt_number(tjson_t *array, int index, double opt) {
 }
 
 const char* tjson_array_opt_string(tjson_t *array, int index, const char* opt) {
+    if (array && array->flags & TJSON_FLAG_PACKED) return opt;
     tjson_t *string = tjson_array_get(array, index);
     if (!string) return opt;
     if (string->type != TJSON_STRING) return opt;
@@ -460,6 +1190,7 @@ const char* tjson_array_opt_string(tjson_t *array, int index, const char* opt) {
 }
 
 int tjson_array_opt_bool(tjson_t *array, int index, int opt) {
+    if (array && array->flags & TJSON_FLAG_PACKED) return opt;
     tjson_t *boolean = tjson_array_get(array, index);
     if (!boolean) return opt;
     if (boolean->type != TJSON_BOOL) return opt;
@@ -468,6 +1199,7 @@ int tjson_array_opt_bool(tjson_t *array, int index, int opt) {
 }
 
 tjson_t* tjson_array_opt_array(tjson_t *array, int index, tjson_t* opt) {
+    if (array && array->flags & TJSON_FLAG_PACKED) return opt;
     tjson_t *item = tjson_array_get(array, index);
     if (!item) return opt;
     if (item->type != TJSON_ARRAY) return opt;
@@ -475,6 +1207,7 @@ tjson_t* tjson_array_opt_array(tjson_t *array, int index, tjson_t* opt) {
 }
 
 tjson_t* tjson_array_opt_object(tjson_t *array, int index, tjson_t* opt) {
+    if (array && array->flags & TJSON_FLAG_PACKED) return opt;
     tjson_t *item = tjson_array_get(array, index);
     if (!item) return opt;
     if (item->type != TJSON_OBJECT) return opt;
@@ -482,19 +1215,22 @@ tjson_t* tjson_array_opt_object(tjson_t *array, int index, tjson_t* opt) {
 }
 
 void tjson_array_push_number(tjson_t *array, double value) {
-    if (!array) return;
+    if (!array || array->flags & TJSON_FLAG_FROZEN) return;
+    if (array->type == TJSON_ARRAY && (array->flags & TJSON_FLAG_PACKED || !array->child)) {
+        if (s_packed_push(array, value)) return;
+    }
     tjson_t *number = tjson_create_number(value);
     tjson_array_push(array, number);
 }
 
 void tjson_array_push_string(tjson_t *array, const char* value) {
-    if (!array) return;
+    if (!array || array->flags & TJSON_FLAG_FROZEN) return;
     tjson_t *string = tjson_create_string(value);
     tjson_array_push(array, string);
 }
 
 void tjson_array_push_bool(tjson_t *array, int value) {
-    if (!array) return;
+    if (!array || array->flags & TJSON_FLAG_FROZEN) return;
     tjson_t *boolean = tjson_create_bool(value);
     tjson_array_push(array, boolean);
 }
@@ -508,6 +1244,13 @@ void tjson_array_push_object(tjson_t *array, tjson_t *value) {
 }
 
 double tjson_array_pop_number(tjson_t *array) {
+    if (!array || array->flags & TJSON_FLAG_FROZEN) return TJSON_NUMBER_ERROR;
+    if (array->flags & TJSON_FLAG_PACKED) {
+        tjson_packed_t *packed = array->packed;
+        double value = TJSON_PACKED_DATA(packed)[--packed->count];
+        if (!packed->count) tjson_clear(array);
+        return value;
+    }
     tjson_t *last = tjson_array_pop(array);
     if (!last) return TJSON_NUMBER_ERROR;
     double value = last->number;
@@ -538,7 +1281,7 @@ tjson_t* tjson_array_pop_object(tjson_t *array) {
  *==============*/
 
 tjson_t* tjson_object_set(tjson_t *object, const char *name, tjson_t *value) {
-    if (!object) return NULL;
+    if (!object || object->flags & TJSON_FLAG_FROZEN) return NULL;
     if (object->type != TJSON_OBJECT) return NULL;
     if (!value) return NULL;
 
@@ -583,27 +1326,35 @@ tjson_t* tjson_object_get(tjson_t *object, const char *name) {
     return NULL;
 }
 
+/* the member replaced by tjson_object_set belongs to nobody anymore */
+static int s_object_replace(tjson_t *object, const char *name, tjson_t *value) {
+    tjson_t *old = tjson_object_set(object, name, value);
+    if (!old) return 0;
+    if (old != value) tjson_delete(old);
+    return 1;
+}
+
 void tjson_object_set_number(tjson_t *object, const char *name, double value) {
     tjson_t *number = tjson_create_number(value);
-    if (!tjson_object_set(object, name, number)) tjson_delete(number);
+    if (!s_object_replace(object, name, number)) tjson_delete(number);
 }
 
 void tjson_object_set_string(tjson_t *object, const char *name, const char* value) {
     tjson_t *string = tjson_create_string(value);
-    if (!tjson_object_set(object, name, string)) tjson_delete(string);
+    if (!s_object_replace(object, name, string)) tjson_delete(string);
 }
 
 void tjson_object_set_bool(tjson_t *object, const char *name, int value) {
     tjson_t *boolean = tjson_create_bool(value);
-    if (!tjson_object_set(object, name, boolean)) tjson_delete(boolean);
+    if (!s_object_replace(object, name, boolean)) tjson_delete(boolean);
 }
 
 void tjson_object_set_array(tjson_t *object, const char *name, tjson_t *value) {
-    tjson_object_set(object, name, value);
+    s_object_replace(object, name, value);
 }
 
 void tjson_object_set_object(tjson_t *object, const char *name, tjson_t *value) {
-    tjson_object_set(object, name, value);
+    s_object_replace(object, name, value);
 }
 
 double tjson_object_opt_number(tjson_t *object, const char *name, double opt) {
@@ -641,101 +1392,1098 @@ tjson_t* tjson_object_opt_object(tjson_t *object, const char *name, tjson_t *opt
     return item;
 }
 
-/*==============*
- *   Scanner    *
- *==============*/
+/*===============*
+ *    Compare    *
+ *===============*/
 
-static int is_digit(char c) { return c >= '0' && c <= '9'; }
-static int is_alpha(char c) { return c >= 'a' && c <= 'z'; }
-static int is_at_end() { return *(scanner.current) == '\0'; }
-static char advance_scanner() {
-    scanner.current++;
-    return scanner.current[-1];
+tjson_t* tjson_clone(tjson_t* json) {
+    if (!json) return NULL;
+    tjson_t* clone = tjson_create((TJSON_TYPE_)json->type);
+    if (!clone) return NULL;
+    if (json->name) clone->name = s_str_assign(NULL, json->name, s_str_len(json->name));
+
+    switch (json->type) {
+        case TJSON_NUMBER:
+            clone->number = json->number;
+            break;
+        case TJSON_BOOL:
+            clone->boolean = json->boolean;
+            break;
+        case TJSON_STRING:
+            if (json->string) clone->string = s_str_assign(NULL, json->string, s_str_len(json->string));
+            break;
+        case TJSON_ARRAY:
+        case TJSON_OBJECT:
+            if (json->flags & TJSON_FLAG_PACKED) {
+                int count = json->packed->count;
+                tjson_packed_t* packed = s_packed_reserve(clone, count);
+                if (!packed) break;
+                memcpy(TJSON_PACKED_DATA(packed), TJSON_PACKED_DATA(json->packed), count * sizeof(double));
+                packed->count = count;
+            } else {
+                tjson_t* last = NULL;
+                tjson_t* el = NULL;
+                tjson_foreach(el, json) {
+                    tjson_t* child = tjson_clone(el);
+                    if (!child) continue;
+                    if (last) last->next = child;
+                    else clone->child = child;
+                    last = child;
+                }
+            }
+            break;
+    }
+    return clone;
 }
-static char peek() { return *(scanner.current); };
-static char peek_next() {
-    if (is_at_end()) return '\0';
-    return scanner.current[1];
+
+static unsigned int s_hash_bytes(unsigned int hash, const void* data, size_t len) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t i;
+    for (i = 0; i < len; i++) hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
 }
-static void skip_whitespace() {
-    for (;;) {
-        char c = peek();
-        switch(c) {
-            case ' ':
-            case '\r':
-            case '\t':
-                advance_scanner();
-                break;
-            case '\n':
-                scanner.line++;
-                advance_scanner();
-                break;
-            default:
-                return;
-        }
-    }
+
+static unsigned int s_hash_number(double value) {
+    if (value == 0) value = 0; /* -0 == 0 */
+    return s_hash_bytes(2166136261u ^ TJSON_NUMBER, &value, sizeof(value));
 }
 
-static tjson_token_t s_make_token(TJSON_TOKEN_ type) {
-    tjson_token_t token;
-    token.type = type;
-    token.start = scanner.start;
-    token.length = (int)(scanner.current - scanner.start);
-    token.line = scanner.line;
-    return token;
+static unsigned int s_hash_mix(unsigned int hash) {
+    hash ^= hash >> 16;
+    hash *= 0x7feb352du;
+    hash ^= hash >> 15;
+    hash *= 0x846ca68bu;
+    hash ^= hash >> 16;
+    return hash;
 }
 
-static tjson_token_t s_error_token(const char* message) {
-    tjson_token_t token;
-    token.type = TJSON_TOKEN_ERROR;
-    token.start = message;
-    token.length = (int)strlen(message);
-    token.line = scanner.line;
-    return token;
+static unsigned int s_hash_name(const char* name) {
+    return name ? s_hash_bytes(2166136261u, name, s_str_len(name)) : 0;
 }
 
-static TJSON_TOKEN_ identifier_type() {
-    switch (scanner.start[0]) {
-        case 'n': return TJSON_TOKEN_NULL;
-        case 't': return TJSON_TOKEN_TRUE;
-        case 'f': return TJSON_TOKEN_FALSE;
-    }
-    return TJSON_TOKEN_IDENTIFIER;
+static int s_name_equal(const char* a, const char* b) {
+    if (!a || !b) return a == b;
+    int len = s_str_len(a);
+    return len == s_str_len(b) && !memcmp(a, b, len);
 }
 
-static tjson_token_t string_token() {
-    while (peek() != '"' && !is_at_end()) {
-        if (peek() == '\n') scanner.line++;
-        advance_scanner();
-    }
+/* open addressing table of an object's members by name, for wide objects */
+static tjson_t** s_index_build(tjson_t* object, int count, unsigned int* size) {
+    *size = 32;
+    while (*size < (unsigned int)count * 2) *size <<= 1;
+    tjson_t** table = (tjson_t**)s_malloc(*size * sizeof(tjson_t*));
+    if (!table) return NULL;
+    memset(table, 0, *size * sizeof(tjson_t*));
 
-    if (is_at_end()) return s_error_token("Unterminated string");
+    tjson_t* el = NULL;
+    tjson_foreach(el, object) {
+        unsigned int slot = s_hash_name(el->name) & (*size - 1);
+        while (table[slot]) slot = (slot + 1) & (*size - 1);
+        table[slot] = el;
+    }
+    return table;
+}
 
-    advance_scanner();
-    return s_make_token(TJSON_TOKEN_STRING);
+static tjson_t* s_index_find(tjson_t** table, unsigned int size, const char* name) {
+    unsigned int slot = s_hash_name(name) & (size - 1);
+    while (table[slot] && !s_name_equal(table[slot]->name, name)) slot = (slot + 1) & (size - 1);
+    return table[slot];
 }
 
-static tjson_token_t number_token() {
-    while (is_digit(peek())) advance_scanner();
-    if (peek() == '.' && is_digit(peek_next())) {
-        advance_scanner();
-        while (is_digit(peek())) advance_scanner();
+unsigned int tjson_hash(tjson_t* json) {
+    if (!json) return 0;
+    unsigned int hash = 2166136261u ^ json->type;
+
+    switch (json->type) {
+        case TJSON_NUMBER:
+            return s_hash_number(json->number);
+        case TJSON_BOOL:
+            return s_hash_mix(hash ^ (json->boolean != 0));
+        case TJSON_STRING:
+            return json->string ? s_hash_bytes(hash, json->string, s_str_len(json->string)) : hash;
+        case TJSON_ARRAY:
+            /* ordered, packed and node arrays hash alike */
+            if (json->flags & TJSON_FLAG_PACKED) {
+                const double* numbers = TJSON_PACKED_DATA(json->packed);
+                int i;
+                for (i = 0; i < json->packed->count; i++) hash = hash * 31 + s_hash_number(numbers[i]);
+            } else {
+                tjson_t* el = NULL;
+                tjson_foreach(el, json) hash = hash * 31 + tjson_hash(el);
+            }
+            return s_hash_mix(hash);
+        case TJSON_OBJECT:
+            /* members are summed, so their order doesn't matter */
+            {
+                unsigned int sum = 0;
+                tjson_t* el = NULL;
+                tjson_foreach(el, json) sum += s_hash_mix(s_hash_name(el->name) ^ (tjson_hash(el) * 0x9e3779b9u));
+                return s_hash_mix(hash ^ sum);
+            }
     }
-    return s_make_token(TJSON_TOKEN_NUMBER);
+    return s_hash_mix(hash);
 }
 
-static tjson_token_t identifier_token() {
-    while (is_alpha(peek())) advance_scanner();
-    return s_make_token(identifier_type());
-}
+static int s_equal_object(tjson_t* a, tjson_t* b) {
+    int count = 0;
+    tjson_t* el = NULL;
+    tjson_t* other = NULL;
+    tjson_foreach(el, a) count++;
+    tjson_foreach(el, b) count--;
+    if (count) return 0;
+    tjson_foreach(el, a) count++;
+
+    /* wide objects index b's members by name instead of rescanning them */
+    if (count > 16) {
+        unsigned int size;
+        tjson_t** table = s_index_build(b, count, &size);
+        if (table) {
+            int equal = 1;
+            tjson_foreach(el, a) {
+                other = s_index_find(table, size, el->name);
+                if (!other || !tjson_equal(el, other)) {
+                    equal = 0;
+                    break;
+                }
+            }
+            s_free(table);
+            return equal;
+        }
+    }
 
-static void s_init_scanner(const char* json_str) {
-    scanner.start = json_str;
-    scanner.current = json_str;
-    scanner.line = 1;
+    tjson_foreach(el, a) {
+        tjson_foreach(other, b) {
+            if (s_name_equal(el->name, other->name)) break;
+        }
+        if (!other || !tjson_equal(el, other)) return 0;
+    }
+    return 1;
 }
 
-static tjson_token_t s_scan_token(void) {
+static int s_equal_packed(tjson_t* packed, tjson_t* array) {
+    const double* numbers = TJSON_PACKED_DATA(packed->packed);
+    int count = packed->packed->count;
+    int i;
+    if (array->flags & TJSON_FLAG_PACKED) {
+        if (array->packed->count != count) return 0;
+        for (i = 0; i < count; i++) {
+            if (numbers[i] != TJSON_PACKED_DATA(array->packed)[i]) return 0;
+        }
+        return 1;
+    }
+
+    tjson_t* el = NULL;
+    i = 0;
+    tjson_foreach(el, array) {
+        if (i == count || el->type != TJSON_NUMBER || el->number != numbers[i]) return 0;
+        i++;
+    }
+    return i == count;
+}
+
+int tjson_equal(tjson_t* a, tjson_t* b) {
+    if (a == b) return 1;
+    if (!a || !b || a->type != b->type) return 0;
+
+    switch (a->type) {
+        case TJSON_NULL:
+            return 1;
+        case TJSON_NUMBER:
+            return a->number == b->number;
+        case TJSON_BOOL:
+            return !a->boolean == !b->boolean;
+        case TJSON_STRING:
+            return s_name_equal(a->string, b->string);
+        case TJSON_ARRAY:
+            if (a->flags & TJSON_FLAG_PACKED) return s_equal_packed(a, b);
+            if (b->flags & TJSON_FLAG_PACKED) return s_equal_packed(b, a);
+            a = a->child;
+            b = b->child;
+            while (a && b) {
+                if (!tjson_equal(a, b)) return 0;
+                a = a->next;
+                b = b->next;
+            }
+            return a == b;
+        case TJSON_OBJECT:
+            return s_equal_object(a, b);
+    }
+    return 0;
+}
+
+/*=============*
+ *    Patch    *
+ *=============*/
+
+/* link pointing at the member called 'name', or at the list's end */
+static tjson_t** s_object_link(tjson_t* object, const char* name) {
+    tjson_t** link = &object->child;
+    while (*link && !s_name_equal((*link)->name, name)) link = &(*link)->next;
+    return link;
+}
+
+static void s_merge_object(tjson_t* target, tjson_t* patch);
+
+/* the value a member takes when its current one can't be patched in place */
+static tjson_t* s_merge_value(tjson_t* patch) {
+    if (patch->type != TJSON_OBJECT) return tjson_clone(patch);
+    tjson_t* object = tjson_create_object();
+    if (object) s_merge_object(object, patch);
+    return object;
+}
+
+static void s_merge_object(tjson_t* target, tjson_t* patch) {
+    tjson_t* el = NULL;
+    tjson_foreach(el, patch) {
+        if (!el->name) continue;
+        tjson_t** link = s_object_link(target, el->name);
+        tjson_t* member = *link;
+
+        if (el->type == TJSON_NULL) {
+            if (member) {
+                *link = member->next;
+                member->next = NULL;
+                tjson_delete(member);
+            }
+            continue;
+        }
+        if (member && member->type == TJSON_OBJECT && el->type == TJSON_OBJECT) {
+            s_merge_object(member, el);
+            continue;
+        }
+
+        tjson_t* value = s_merge_value(el);
+        if (!value) continue;
+        value->name = s_str_assign(value->name, el->name, s_str_len(el->name));
+        *link = value;
+        if (member) {
+            value->next = member->next;
+            member->next = NULL;
+            tjson_delete(member);
+        }
+    }
+}
+
+static void s_merge_rename(tjson_t* json, const char* name) {
+    if (!json) return;
+    if (name) json->name = s_str_assign(json->name, name, s_str_len(name));
+    else {
+        s_str_free(json->name);
+        json->name = NULL;
+    }
+}
+
+tjson_t* tjson_merge_patch(tjson_t* target, tjson_t* patch) {
+    if (!patch) return target;
+    if (target && target->flags & TJSON_FLAG_FROZEN) return NULL;
+
+    if (patch->type != TJSON_OBJECT || !target || target->type != TJSON_OBJECT) {
+        tjson_t* value = s_merge_value(patch);
+        s_merge_rename(value, target ? target->name : NULL);
+        tjson_delete(target);
+        return value;
+    }
+
+    s_merge_object(target, patch);
+    return target;
+}
+
+static void s_diff_member(tjson_t* patch, tjson_t** last, const char* name, tjson_t* value) {
+    if (!value) return;
+    s_merge_rename(value, name);
+    if (*last) (*last)->next = value;
+    else patch->child = value;
+    *last = value;
+}
+
+tjson_t* tjson_merge_diff(tjson_t* from, tjson_t* to) {
+    if (!to) return NULL;
+    if (!from || from->type != TJSON_OBJECT || to->type != TJSON_OBJECT) {
+        tjson_t* value = tjson_clone(to);
+        s_merge_rename(value, NULL);
+        return value;
+    }
+
+    tjson_t* patch = tjson_create_object();
+    if (!patch) return NULL;
+    tjson_t* last = NULL;
+    tjson_t* el = NULL;
+
+    /* wide objects are looked up through a name index */
+    int from_count = 0, to_count = 0;
+    tjson_foreach(el, from) from_count++;
+    tjson_foreach(el, to) to_count++;
+    unsigned int from_size = 0, to_size = 0;
+    tjson_t** from_index = from_count > 16 ? s_index_build(from, from_count, &from_size) : NULL;
+    tjson_t** to_index = to_count > 16 ? s_index_build(to, to_count, &to_size) : NULL;
+
+    tjson_foreach(el, from) {
+        if (!el->name) continue;
+        tjson_t* other = to_index ? s_index_find(to_index, to_size, el->name) : *s_object_link(to, el->name);
+        if (!other) s_diff_member(patch, &last, el->name, tjson_create_null());
+    }
+
+    tjson_foreach(el, to) {
+        if (!el->name) continue;
+        tjson_t* other = from_index ? s_index_find(from_index, from_size, el->name) : *s_object_link(from, el->name);
+        if (!other) s_diff_member(patch, &last, el->name, tjson_clone(el));
+        else if (!tjson_equal(other, el)) s_diff_member(patch, &last, el->name, tjson_merge_diff(other, el));
+    }
+
+    s_free(from_index);
+    s_free(to_index);
+    return patch;
+}
+
+/*==============*
+ *    Shared    *
+ *==============*/
+
+struct tjson_shared_s {
+    tjson_t* root;
+    long refs;
+};
+
+/* Readers count themselves in the half of 'readers' picked by 'epoch'.
+ * publish moves new readers to the other half, so it only waits for the
+ * ones that may have seen the old version, not for a steady stream. */
+/* test hook, lets a reader stall at each step of tjson_slot_acquire */
+#if !defined(TJSON_SLOT_STALL)
+#define TJSON_SLOT_STALL(slot)
+#endif
+
+struct tjson_slot_s {
+    tjson_shared_t* current;
+    long epoch;
+    long readers[2];
+    long lock; /* publishers, one at a time */
+};
+
+/* packed arrays keep their numbers, see s_array_child */
+static void s_freeze(tjson_t* json, int frozen) {
+    while (json) {
+        if (frozen) json->flags |= TJSON_FLAG_FROZEN;
+        else json->flags &= ~TJSON_FLAG_FROZEN;
+        if (json->flags & TJSON_FLAG_PACKED) s_freeze(json->packed->nodes, frozen);
+        else if (json->type == TJSON_ARRAY || json->type == TJSON_OBJECT) s_freeze(json->child, frozen);
+        json = json->next;
+    }
+}
+
+tjson_shared_t* tjson_share(tjson_t* json) {
+    if (!json || json->flags & TJSON_FLAG_FROZEN) return NULL;
+    tjson_shared_t* shared = (tjson_shared_t*)s_malloc(sizeof(*shared));
+    if (!shared) return NULL;
+
+    /* only the root's subtree, not its siblings */
+    tjson_t* next = json->next;
+    json->next = NULL;
+    s_freeze(json, 1);
+    json->next = next;
+
+    shared->root = json;
+    shared->refs = 1;
+    return shared;
+}
+
+tjson_shared_t* tjson_shared_retain(tjson_shared_t* shared) {
+    if (shared) TJSON_ATOMIC_INC(&shared->refs);
+    return shared;
+}
+
+void tjson_shared_release(tjson_shared_t* shared) {
+    if (!shared || TJSON_ATOMIC_DEC(&shared->refs) != 0) return;
+    tjson_t* json = shared->root;
+    tjson_t* next = json->next;
+    json->next = NULL;
+    s_freeze(json, 0);
+    json->next = next;
+    tjson_delete(json);
+    s_free(shared);
+}
+
+tjson_t* tjson_shared_get(tjson_shared_t* shared) {
+    if (!shared) return NULL;
+    return shared->root;
+}
+
+int tjson_is_frozen(tjson_t* json) {
+    if (!json) return 0;
+    return (json->flags & TJSON_FLAG_FROZEN) != 0;
+}
+
+tjson_slot_t* tjson_slot_create(tjson_shared_t* shared) {
+    tjson_slot_t* slot = (tjson_slot_t*)s_malloc(sizeof(*slot));
+    if (!slot) return NULL;
+    slot->current = shared;
+    slot->epoch = 0;
+    slot->readers[0] = slot->readers[1] = 0;
+    slot->lock = 0;
+    return slot;
+}
+
+tjson_shared_t* tjson_slot_acquire(tjson_slot_t* slot) {
+    if (!slot) return NULL;
+    /* counted in the half of an epoch that was still current afterwards, so
+     * the publish flipping away from it waits for this reader */
+    long* readers;
+    for (;;) {
+        long epoch = TJSON_ATOMIC_LOAD(&slot->epoch);
+        readers = &slot->readers[epoch & 1];
+        TJSON_SLOT_STALL(slot);
+        TJSON_ATOMIC_INC(readers);
+        if (TJSON_ATOMIC_LOAD(&slot->epoch) == epoch) break;
+        TJSON_ATOMIC_DEC(readers);
+    }
+    tjson_shared_t* shared = (tjson_shared_t*)TJSON_ATOMIC_LOAD_PTR(&slot->current);
+    TJSON_SLOT_STALL(slot);
+    tjson_shared_retain(shared);
+    TJSON_ATOMIC_DEC(readers);
+    return shared;
+}
+
+void tjson_slot_publish(tjson_slot_t* slot, tjson_shared_t* shared) {
+    if (!slot) return;
+    while (TJSON_ATOMIC_XCHG(&slot->lock, 1)) {}
+    tjson_shared_t* old = (tjson_shared_t*)TJSON_ATOMIC_XCHG_PTR(&slot->current, shared);
+    /* a reader that loaded 'old' is counted in the half of this epoch until
+     * it holds its own reference: it checked the epoch after counting itself
+     * in, and earlier publishes had already waited for their half */
+    long epoch = TJSON_ATOMIC_ADD(&slot->epoch, 1) - 1;
+    while (TJSON_ATOMIC_LOAD(&slot->readers[epoch & 1]) != 0) {}
+    TJSON_ATOMIC_XCHG(&slot->lock, 0);
+    tjson_shared_release(old);
+}
+
+void tjson_slot_destroy(tjson_slot_t* slot) {
+    if (!slot) return;
+    tjson_shared_release(slot->current);
+    s_free(slot);
+}
+
+/*=============*
+ *    Cache    *
+ *=============*/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* sub-second part of the mtime, files rewritten within a second differ
+ * there; each libc spells it differently, or doesn't have it at all */
+#if defined(__APPLE__) && defined(st_mtime)
+#define TJSON_MTIME_NSEC(st) ((long)(st).st_mtimespec.tv_nsec)
+#elif defined(__APPLE__) || (defined(__GLIBC__) && !defined(st_mtime))
+#define TJSON_MTIME_NSEC(st) ((long)(st).st_mtimensec)
+#elif defined(st_mtime) && !defined(_WIN32)
+#define TJSON_MTIME_NSEC(st) ((long)(st).st_mtim.tv_nsec)
+#else
+#define TJSON_MTIME_NSEC(st) 0L
+#endif
+
+typedef struct tjson_cache_entry_s tjson_cache_entry_t;
+
+struct tjson_cache_entry_s {
+    char* filename;
+    unsigned long size;
+    unsigned long inode;
+    long mtime;
+    long mtime_nsec;
+    tjson_shared_t* shared;
+    size_t bytes;
+    tjson_cache_entry_t* prev;
+    tjson_cache_entry_t* next;
+};
+
+/* entries from most to least recently used */
+struct tjson_cache_s {
+    tjson_cache_entry_t* head;
+    tjson_cache_entry_t* tail;
+    size_t budget;
+    size_t bytes;
+    unsigned long hits;
+    unsigned long misses;
+    long lock;
+};
+
+/* the lock only covers list updates, reading and parsing happen outside */
+static void s_cache_lock(tjson_cache_t* cache) { while (TJSON_ATOMIC_XCHG(&cache->lock, 1)) {} }
+static void s_cache_unlock(tjson_cache_t* cache) { TJSON_ATOMIC_XCHG(&cache->lock, 0); }
+
+static size_t s_string_bytes(const char* str) {
+    return str ? sizeof(tjson_string_t) + TJSON_STRING_HEADER(str)->capacity + 1 : 0;
+}
+
+/* memory held by a tree, not counting nodes built later for packed arrays */
+static size_t s_tree_bytes(tjson_t* json) {
+    size_t bytes = sizeof(tjson_t) + s_string_bytes(json->name);
+    if (json->type == TJSON_STRING) bytes += s_string_bytes(json->string);
+    else if (json->flags & TJSON_FLAG_PACKED) bytes += sizeof(tjson_packed_t) + json->packed->capacity * sizeof(double);
+    else if (json->type == TJSON_ARRAY || json->type == TJSON_OBJECT) {
+        tjson_t* el = NULL;
+        tjson_foreach(el, json) bytes += s_tree_bytes(el);
+    }
+    return bytes;
+}
+
+static void s_cache_unlink(tjson_cache_t* cache, tjson_cache_entry_t* entry) {
+    if (entry->prev) entry->prev->next = entry->next;
+    else cache->head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev;
+    else cache->tail = entry->prev;
+    entry->prev = entry->next = NULL;
+    cache->bytes -= entry->bytes;
+}
+
+static void s_cache_push(tjson_cache_t* cache, tjson_cache_entry_t* entry) {
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head) cache->head->prev = entry;
+    else cache->tail = entry;
+    cache->head = entry;
+    cache->bytes += entry->bytes;
+}
+
+static void s_cache_entry_free(tjson_cache_entry_t* entry) {
+    while (entry) {
+        tjson_cache_entry_t* next = entry->next;
+        tjson_shared_release(entry->shared);
+        s_free(entry->filename);
+        s_free(entry);
+        entry = next;
+    }
+}
+
+tjson_cache_t* tjson_cache_create(size_t budget) {
+    tjson_cache_t* cache = (tjson_cache_t*)s_malloc(sizeof(*cache));
+    if (!cache) return NULL;
+    memset(cache, 0, sizeof(*cache));
+    cache->budget = budget;
+    return cache;
+}
+
+void tjson_cache_destroy(tjson_cache_t* cache) {
+    if (!cache) return;
+    s_cache_entry_free(cache->head);
+    s_free(cache);
+}
+
+tjson_shared_t* tjson_cache_open(tjson_cache_t* cache, const char* filename) {
+    if (!cache || !filename) return NULL;
+    struct stat st;
+    if (stat(filename, &st) != 0) {
+        fprintf(stderr, "Failed to open %s\n", filename);
+        return NULL;
+    }
+
+    /* entries dropped under the lock are released after it */
+    tjson_cache_entry_t* dropped = NULL;
+    tjson_cache_entry_t* entry = NULL;
+    tjson_shared_t* shared = NULL;
+
+    s_cache_lock(cache);
+    for (entry = cache->head; entry; entry = entry->next) {
+        if (strcmp(entry->filename, filename)) continue;
+        s_cache_unlink(cache, entry);
+        if (entry->size == (unsigned long)st.st_size && entry->mtime == (long)st.st_mtime &&
+            entry->mtime_nsec == TJSON_MTIME_NSEC(st) && entry->inode == (unsigned long)st.st_ino) {
+            s_cache_push(cache, entry);
+            cache->hits++;
+            shared = tjson_shared_retain(entry->shared);
+        } else {
+            entry->next = dropped;
+            dropped = entry;
+        }
+        break;
+    }
+    if (!shared) cache->misses++;
+    s_cache_unlock(cache);
+    s_cache_entry_free(dropped);
+    if (shared) return shared;
+    dropped = NULL;
+
+    shared = tjson_share(tjson_open(filename));
+    if (!shared) return NULL;
+    entry = (tjson_cache_entry_t*)s_malloc(sizeof(*entry));
+    char* name = s_strdup(filename, strlen(filename));
+    if (!entry || !name) {
+        s_free(entry);
+        s_free(name);
+        return shared;
+    }
+    entry->filename = name;
+    entry->size = (unsigned long)st.st_size;
+    entry->mtime = (long)st.st_mtime;
+    entry->mtime_nsec = TJSON_MTIME_NSEC(st);
+    entry->inode = (unsigned long)st.st_ino;
+    entry->shared = tjson_shared_retain(shared);
+    entry->bytes = s_tree_bytes(tjson_shared_get(shared)) + sizeof(*entry) + strlen(filename) + 1;
+
+    s_cache_lock(cache);
+    /* another thread may have loaded the same file meanwhile, newest wins */
+    tjson_cache_entry_t* other = NULL;
+    for (other = cache->head; other; other = other->next) {
+        if (!strcmp(other->filename, filename)) {
+            s_cache_unlink(cache, other);
+            other->next = dropped;
+            dropped = other;
+            break;
+        }
+    }
+    s_cache_push(cache, entry);
+    while (cache->bytes > cache->budget && cache->tail != entry) {
+        other = cache->tail;
+        s_cache_unlink(cache, other);
+        other->next = dropped;
+        dropped = other;
+    }
+    /* a single file over budget isn't kept either */
+    if (cache->bytes > cache->budget) {
+        s_cache_unlink(cache, entry);
+        entry->next = dropped;
+        dropped = entry;
+    }
+    s_cache_unlock(cache);
+    s_cache_entry_free(dropped);
+    return shared;
+}
+
+void tjson_cache_stats(tjson_cache_t* cache, unsigned long* hits, unsigned long* misses, size_t* bytes) {
+    if (!cache) return;
+    s_cache_lock(cache);
+    if (hits) *hits = cache->hits;
+    if (misses) *misses = cache->misses;
+    if (bytes) *bytes = cache->bytes;
+    s_cache_unlock(cache);
+}
+
+/*===============*
+ *    Pointer    *
+ *===============*/
+
+typedef struct {
+    const char* key;
+    int length;
+    int index;
+} tjson_segment_t;
+
+struct tjson_path_s {
+    int count;
+    tjson_segment_t* segments;
+};
+
+/* array index of a reference token, -1 if it isn't one */
+static int s_pointer_index(const char* key, const char* end) {
+    int index = 0;
+    if (key == end || (*key == '0' && end - key > 1)) return -1;
+    while (key < end) {
+        if (*key < '0' || *key > '9' || index > (0x7fffffff - 9) / 10) return -1;
+        index = index * 10 + (*key++ - '0');
+    }
+    return index;
+}
+
+/* compares a member name against an escaped reference token */
+static int s_pointer_key_equals(const char* name, const char* key, const char* end) {
+    while (key < end) {
+        char c = *key++;
+        if (c == '~') {
+            if (key == end) return 0;
+            if (*key == '0') c = '~';
+            else if (*key == '1') c = '/';
+            else return 0;
+            key++;
+        }
+        if (*name++ != c) return 0;
+    }
+    return *name == '\0';
+}
+
+static const char* s_pointer_token_end(const char* key) {
+    while (*key && *key != '/') key++;
+    return key;
+}
+
+/* Element 'index' of a packed array can only be the end of a path: returns
+ * the array with *packed_index set, NULL when out of range or not the end. */
+static tjson_t* s_pointer_packed(tjson_t* array, int index, int last, int* packed_index) {
+    if (!last || index < 0 || index >= array->packed->count) return NULL;
+    *packed_index = index;
+    return array;
+}
+
+/* Resolves the pointer. Stops at a packed array rather than creating its
+ * nodes, with *packed_index set to the element (-1 otherwise). */
+static tjson_t* s_pointer_walk(tjson_t* json, const char* pointer, int* packed_index) {
+    *packed_index = -1;
+    if (!json || !pointer) return NULL;
+    if (*pointer && *pointer != '/') return NULL;
+
+    while (json && *pointer) {
+        const char* key = pointer + 1;
+        const char* end = s_pointer_token_end(key);
+        if (json->type == TJSON_OBJECT) {
+            tjson_t* el = NULL;
+            tjson_foreach(el, json) {
+                if (el->name && s_pointer_key_equals(el->name, key, end)) break;
+            }
+            json = el;
+        } else if (json->type == TJSON_ARRAY) {
+            int index = s_pointer_index(key, end);
+            if (json->flags & TJSON_FLAG_PACKED) return s_pointer_packed(json, index, !*end, packed_index);
+            json = index < 0 ? NULL : tjson_array_get(json, index);
+        } else json = NULL;
+        pointer = end;
+    }
+
+    return json;
+}
+
+tjson_t* tjson_pointer_get(tjson_t* json, const char* pointer) {
+    int index;
+    json = s_pointer_walk(json, pointer, &index);
+    return index < 0 ? json : tjson_array_get(json, index);
+}
+
+double tjson_pointer_opt_number(tjson_t* json, const char* pointer, double opt) {
+    int index;
+    json = s_pointer_walk(json, pointer, &index);
+    if (index >= 0) return TJSON_PACKED_DATA(json->packed)[index];
+    return json && json->type == TJSON_NUMBER ? json->number : opt;
+}
+
+tjson_path_t* tjson_path_compile(const char* pointer) {
+    if (!pointer) return NULL;
+    if (*pointer && *pointer != '/') return NULL;
+
+    int count = 0;
+    const char* iter;
+    for (iter = pointer; *iter; iter++) if (*iter == '/') count++;
+
+    /* header, segments and the decoded keys share a single allocation */
+    size_t size = sizeof(tjson_path_t) + count * sizeof(tjson_segment_t) + strlen(pointer) + 1;
+    tjson_path_t* path = (tjson_path_t*)s_malloc(size);
+    if (!path) return NULL;
+    path->count = count;
+    path->segments = (tjson_segment_t*)(path + 1);
+    char* keys = (char*)(path->segments + count);
+
+    int i;
+    for (i = 0; i < count; i++) {
+        const char* key = pointer + 1;
+        const char* end = s_pointer_token_end(key);
+        tjson_segment_t* seg = &path->segments[i];
+        seg->key = keys;
+        seg->index = s_pointer_index(key, end);
+        while (key < end) {
+            char c = *key++;
+            if (c == '~') {
+                if (key < end && *key == '0') c = '~';
+                else if (key < end && *key == '1') c = '/';
+                else {
+                    s_free(path);
+                    return NULL;
+                }
+                key++;
+            }
+            *keys++ = c;
+        }
+        *keys++ = '\0';
+        seg->length = (int)(keys - seg->key) - 1;
+        pointer = end;
+    }
+
+    return path;
+}
+
+/* s_pointer_walk for a compiled path */
+static tjson_t* s_path_walk(tjson_path_t* path, tjson_t* json, int* packed_index) {
+    *packed_index = -1;
+    if (!path) return NULL;
+
+    int i;
+    for (i = 0; json && i < path->count; i++) {
+        const tjson_segment_t* seg = &path->segments[i];
+        if (json->type == TJSON_OBJECT) {
+            tjson_t* el = NULL;
+            tjson_foreach(el, json) {
+                if (el->name && s_str_len(el->name) == seg->length && !memcmp(el->name, seg->key, seg->length)) break;
+            }
+            json = el;
+        } else if (json->type == TJSON_ARRAY && seg->index >= 0) {
+            if (json->flags & TJSON_FLAG_PACKED) return s_pointer_packed(json, seg->index, i + 1 == path->count, packed_index);
+            json = tjson_array_get(json, seg->index);
+        } else json = NULL;
+    }
+
+    return json;
+}
+
+tjson_t* tjson_path_get(tjson_path_t* path, tjson_t* json) {
+    int index;
+    json = s_path_walk(path, json, &index);
+    return index < 0 ? json : tjson_array_get(json, index);
+}
+
+double tjson_path_opt_number(tjson_path_t* path, tjson_t* json, double opt) {
+    int index;
+    json = s_path_walk(path, json, &index);
+    if (index >= 0) return TJSON_PACKED_DATA(json->packed)[index];
+    return json && json->type == TJSON_NUMBER ? json->number : opt;
+}
+
+void tjson_path_free(tjson_path_t* path) { s_free(path); }
+
+/*==============*
+ *    Reader    *
+ *==============*/
+
+#if defined(TJSON_READ_STREAM)
+#include <pthread.h>
+
+/* A reader thread fills TJSON_READ_BUFFERS rotating chunks while the parser
+ * copies finished ones to the end of the text it scans. The scanner asks
+ * for more when it reaches the '\0' after the copied part. */
+struct tjson_stream_s {
+    FILE* fp;
+    size_t remaining;
+    char* chunks;
+    size_t lengths[TJSON_READ_BUFFERS];
+    int head;
+    int tail;
+    int ready;
+    int done;
+    int failed;
+    int cancel;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    char* end;
+};
+
+static void* s_stream_reader(void* arg) {
+    tjson_stream_t* stream = (tjson_stream_t*)arg;
+    int done = 0;
+    while (!done) {
+        pthread_mutex_lock(&stream->lock);
+        while (stream->ready == TJSON_READ_BUFFERS && !stream->cancel) pthread_cond_wait(&stream->cond, &stream->lock);
+        int slot = stream->head;
+        done = stream->cancel;
+        pthread_mutex_unlock(&stream->lock);
+        if (done) break;
+
+        size_t want = stream->remaining < TJSON_READ_CHUNK ? stream->remaining : TJSON_READ_CHUNK;
+        size_t got = fread(stream->chunks + (size_t)slot * TJSON_READ_CHUNK, 1, want, stream->fp);
+        stream->remaining -= got;
+
+        pthread_mutex_lock(&stream->lock);
+        stream->lengths[slot] = got;
+        if (got) {
+            stream->head = (slot + 1) % TJSON_READ_BUFFERS;
+            stream->ready++;
+        }
+        if (got < want) stream->failed = 1;
+        done = stream->done = got < want || !stream->remaining;
+        pthread_cond_broadcast(&stream->cond);
+        pthread_mutex_unlock(&stream->lock);
+    }
+    return NULL;
+}
+
+/* appends the next chunk, 0 once the file is over */
+static int s_stream_refill(tjson_stream_t* stream) {
+    pthread_mutex_lock(&stream->lock);
+    while (!stream->ready && !stream->done) pthread_cond_wait(&stream->cond, &stream->lock);
+    if (!stream->ready) {
+        pthread_mutex_unlock(&stream->lock);
+        return 0;
+    }
+    int slot = stream->tail;
+    size_t len = stream->lengths[slot];
+    pthread_mutex_unlock(&stream->lock);
+
+    memcpy(stream->end, stream->chunks + (size_t)slot * TJSON_READ_CHUNK, len);
+    stream->end += len;
+    *stream->end = '\0';
+
+    pthread_mutex_lock(&stream->lock);
+    stream->tail = (slot + 1) % TJSON_READ_BUFFERS;
+    stream->ready--;
+    pthread_cond_broadcast(&stream->cond);
+    pthread_mutex_unlock(&stream->lock);
+    return 1;
+}
+
+static int s_scanner_more(const char* at) {
+    return scanner.stream && at == scanner.stream->end && s_stream_refill(scanner.stream);
+}
+
+/* Parses while reading, returns 0 when the file is left to s_file_read
+ * (small, or no thread could be started). */
+static int s_open_stream(const char* filename, tjson_t** out) {
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) return 0;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (size < 2 * TJSON_READ_CHUNK) {
+        fclose(fp);
+        return 0;
+    }
+
+    tjson_stream_t stream;
+    memset(&stream, 0, sizeof(stream));
+    char* text = (char*)s_malloc((size_t)size + 1);
+    stream.chunks = (char*)s_malloc((size_t)TJSON_READ_BUFFERS * TJSON_READ_CHUNK);
+    if (!text || !stream.chunks) {
+        s_free(text);
+        s_free(stream.chunks);
+        fclose(fp);
+        return 0;
+    }
+    stream.fp = fp;
+    stream.remaining = (size_t)size;
+    stream.end = text;
+    *text = '\0';
+    pthread_mutex_init(&stream.lock, NULL);
+    pthread_cond_init(&stream.cond, NULL);
+
+    pthread_t thread;
+    int started = pthread_create(&thread, NULL, s_stream_reader, &stream) == 0;
+    tjson_t* json = NULL;
+    if (started) {
+        scanner.stream = &stream;
+        json = tjson_parse(text);
+        scanner.stream = NULL;
+
+        /* the parser stops after the root value, the rest isn't needed */
+        pthread_mutex_lock(&stream.lock);
+        stream.cancel = 1;
+        pthread_cond_broadcast(&stream.cond);
+        pthread_mutex_unlock(&stream.lock);
+        pthread_join(thread, NULL);
+        if (stream.failed) {
+            fprintf(stderr, "Failed to read %s\n", filename);
+            tjson_delete(json);
+            json = NULL;
+        }
+    }
+
+    pthread_cond_destroy(&stream.cond);
+    pthread_mutex_destroy(&stream.lock);
+    s_free(stream.chunks);
+    s_free(text);
+    fclose(fp);
+    *out = json;
+    return started;
+}
+#else
+#define s_scanner_more(at) 0
+#endif
+
+/*==============*
+ *   Scanner    *
+ *==============*/
+
+static int is_digit(char c) { return c >= '0' && c <= '9'; }
+static int is_alpha(char c) { return c >= 'a' && c <= 'z'; }
+/* '\0' ends the text, unless a file is still being streamed in */
+static int is_at_end() { return *(scanner.current) == '\0' && !s_scanner_more(scanner.current); }
+static char advance_scanner() {
+    scanner.current++;
+    return scanner.current[-1];
+}
+static char peek() { return is_at_end() ? '\0' : *(scanner.current); };
+static char peek_next() {
+    if (is_at_end()) return '\0';
+    if (scanner.current[1] == '\0' && !s_scanner_more(scanner.current + 1)) return '\0';
+    return scanner.current[1];
+}
+static void skip_whitespace() {
+    for (;;) {
+        char c = peek();
+        switch(c) {
+            case ' ':
+            case '\r':
+            case '\t':
+                advance_scanner();
+                break;
+            case '\n':
+                scanner.line++;
+                advance_scanner();
+                break;
+            default:
+                return;
+        }
+    }
+}
+
+static tjson_token_t s_make_token(TJSON_TOKEN_ type) {
+    tjson_token_t token;
+    token.type = type;
+    token.start = scanner.start;
+    token.length = (int)(scanner.current - scanner.start);
+    token.line = scanner.line;
+    return token;
+}
+
+static tjson_token_t s_error_token(const char* message) {
+    tjson_token_t token;
+    token.type = TJSON_TOKEN_ERROR;
+    token.start = message;
+    token.length = (int)strlen(message);
+    token.line = scanner.line;
+    return token;
+}
+
+static TJSON_TOKEN_ identifier_type() {
+    switch (scanner.start[0]) {
+        case 'n': return TJSON_TOKEN_NULL;
+        case 't': return TJSON_TOKEN_TRUE;
+        case 'f': return TJSON_TOKEN_FALSE;
+    }
+    return TJSON_TOKEN_IDENTIFIER;
+}
+
+static tjson_token_t string_token() {
+    while (peek() != '"' && !is_at_end()) {
+        if (peek() == '\n') scanner.line++;
+        advance_scanner();
+    }
+
+    if (is_at_end()) return s_error_token("Unterminated string");
+
+    advance_scanner();
+    return s_make_token(TJSON_TOKEN_STRING);
+}
+
+static tjson_token_t number_token() {
+    while (is_digit(peek())) advance_scanner();
+    if (peek() == '.' && is_digit(peek_next())) {
+        advance_scanner();
+        while (is_digit(peek())) advance_scanner();
+    }
+    if (peek() == 'e' || peek() == 'E') {
+        const char* mark = scanner.current;
+        advance_scanner();
+        if (peek() == '+' || peek() == '-') advance_scanner();
+        if (!is_digit(peek())) scanner.current = mark;
+        while (is_digit(peek())) advance_scanner();
+    }
+    return s_make_token(TJSON_TOKEN_NUMBER);
+}
+
+static tjson_token_t identifier_token() {
+    while (is_alpha(peek())) advance_scanner();
+    return s_make_token(identifier_type());
+}
+
+static void s_init_scanner(const char* json_str) {
+    TJSON_STATS_BEGIN();
+    scanner.start = json_str;
+    scanner.current = json_str;
+    scanner.line = 1;
+}
+
+static tjson_token_t s_scan_next(void) {
     skip_whitespace();
     scanner.start = scanner.current;
     if (is_at_end()) return s_make_token(TJSON_TOKEN_EOF);
@@ -743,156 +2491,1576 @@ static tjson_token_t s_scan_token(void) {
     if (is_alpha(c)) return identifier_token();
     if (is_digit(c)) return number_token();
 
-    switch(c) {
-        case '{': return s_make_token(TJSON_TOKEN_LBRACE);
-        case '}': return s_make_token(TJSON_TOKEN_RBRACE);
-        case '[': return s_make_token(TJSON_TOKEN_LSQUAR);
-        case ']': return s_make_token(TJSON_TOKEN_RSQUAR);
-        case ',': return s_make_token(TJSON_TOKEN_COMMA);
-        case '.': return s_make_token(TJSON_TOKEN_DOT);
-        case '-': return s_make_token(TJSON_TOKEN_MINUS);
-        case ':': return s_make_token(TJSON_TOKEN_COLON);
-        case '"': return string_token();
+    switch(c) {
+        case '{': return s_make_token(TJSON_TOKEN_LBRACE);
+        case '}': return s_make_token(TJSON_TOKEN_RBRACE);
+        case '[': return s_make_token(TJSON_TOKEN_LSQUAR);
+        case ']': return s_make_token(TJSON_TOKEN_RSQUAR);
+        case ',': return s_make_token(TJSON_TOKEN_COMMA);
+        case '.': return s_make_token(TJSON_TOKEN_DOT);
+        case '-': return s_make_token(TJSON_TOKEN_MINUS);
+        case ':': return s_make_token(TJSON_TOKEN_COLON);
+        case '"': return string_token();
+    }
+    return s_error_token("Unexpected character");
+}
+
+static tjson_token_t s_scan_token(void) {
+    TJSON_STATS_PHASE(phase, TJSON_PHASE_SCAN);
+    tjson_token_t token = s_scan_next();
+    TJSON_STATS_ADD(tokens[token.type], 1);
+    TJSON_STATS_PHASE_END(phase);
+    return token;
+}
+
+/*==============*
+ *    Parser    *
+ *==============*/
+
+static void s_error_at(tjson_token_t* token, const char* message) {
+    if (parser.panic_mode) return;
+    parser.panic_mode = 1;
+    fprintf(stderr, "[tinyjson]:%d Error", token->line);
+    if (token->type == TJSON_TOKEN_EOF) fprintf(stderr, " at end");
+    else fprintf(stderr, " at %.*s,", token->length, token->start);
+    fprintf(stderr, " %s\n", message);
+    parser.hand_error = 1;
+}
+
+#if 0
+static void s_error_at_current(const char* message) {
+    s_error_at(&parser.current, message);
+}
+#endif
+
+static char* s_parse_cstring(tjson_token_t* token) {
+    return s_strdup(token->start+1, token->length-2);
+}
+
+static double s_token_number(tjson_token_t* token) {
+    double value;
+    if (token->type == TJSON_TOKEN_MINUS) {
+        tjson_token_t tnext = s_scan_token();
+        TJSON_STATS_PHASE(phase, TJSON_PHASE_NUMBER);
+        value = -strtod(tnext.start, NULL);
+        TJSON_STATS_PHASE_END(phase);
+    } else {
+        TJSON_STATS_PHASE(phase, TJSON_PHASE_NUMBER);
+        value = strtod(token->start, NULL);
+        TJSON_STATS_PHASE_END(phase);
+    }
+    return value;
+}
+
+static tjson_t* s_recycle_node(TJSON_TYPE_ type);
+
+/* next node of the tree being reparsed, keeping the buffers it can reuse */
+static tjson_t* s_parse_node(TJSON_TYPE_ type) {
+    TJSON_STATS_ADD(nodes, 1);
+    TJSON_STATS_PHASE(phase, TJSON_PHASE_NODE);
+    tjson_t* json = s_recycle_node(type);
+    TJSON_STATS_PHASE_END(phase);
+    return json;
+}
+
+static tjson_t* s_recycle_node(TJSON_TYPE_ type) {
+    tjson_t* json = parser.recycle;
+    if (!json) return tjson_create(type);
+    parser.recycle = json->next;
+    json->next = NULL;
+
+    if (json->flags & TJSON_FLAG_PACKED) {
+        if (type == TJSON_ARRAY) json->packed->count = 0;
+        else tjson_clear(json);
+    } else if (json->type == TJSON_STRING && type == TJSON_STRING) {
+        return json;
+    } else {
+        if (json->type == TJSON_STRING) s_str_free(json->string);
+        json->child = NULL;
+    }
+    json->type = type;
+    return json;
+}
+
+/* queues every node of the tree in creation (pre-)order */
+static void s_recycle_collect(tjson_t* json, tjson_t*** tail) {
+    tjson_t* child = NULL;
+    if ((json->type == TJSON_ARRAY || json->type == TJSON_OBJECT) && !(json->flags & TJSON_FLAG_PACKED)) {
+        child = json->child;
+        json->child = NULL;
+    }
+    json->next = NULL;
+    **tail = json;
+    *tail = &json->next;
+    while (child) {
+        tjson_t* next = child->next;
+        s_recycle_collect(child, tail);
+        child = next;
+    }
+}
+
+static tjson_t* s_parse_number(tjson_token_t* token) {
+    double value = s_token_number(token);
+    tjson_t* json = s_parse_node(TJSON_NUMBER);
+    if (json) json->number = value;
+    return json;
+}
+
+static tjson_t* s_parse_string(tjson_token_t* token) {
+    tjson_t* json = s_parse_node(TJSON_STRING);
+    if (json) {
+        TJSON_STATS_ADD(string_bytes, token->length - 2);
+        TJSON_STATS_PHASE(phase, TJSON_PHASE_STRING);
+        json->string = s_str_assign(json->string, token->start+1, token->length-2);
+        TJSON_STATS_PHASE_END(phase);
+    }
+    return json;
+}
+
+static tjson_t* s_parse_bool(int value) {
+    tjson_t* json = s_parse_node(TJSON_BOOL);
+    if (json) json->boolean = value;
+    return json;
+}
+
+static void s_parse_clear_name(tjson_t* json) {
+    s_str_free(json->name);
+    json->name = NULL;
+}
+
+/* The parse functions report errors with s_error_at and return NULL, the
+ * partly built tree is dropped on the way up. */
+static tjson_t* s_parse_json_token(tjson_token_t* token);
+
+static tjson_t* s_parse_abort(tjson_t* json) {
+    TJSON_STATS_LEAVE();
+    tjson_delete(json);
+    return NULL;
+}
+
+static tjson_t* s_parse_object() {
+    TJSON_STATS_ENTER();
+    tjson_t* obj = s_parse_node(TJSON_OBJECT);
+    tjson_t* last = NULL;
+    tjson_token_t token = s_scan_token();
+    while (token.type != TJSON_TOKEN_RBRACE) {
+        tjson_token_t key = token;
+        if (key.type != TJSON_TOKEN_STRING) {
+            s_error_at(&key, "expected key");
+            return s_parse_abort(obj);
+        }
+        token = s_scan_token();
+        if (token.type != TJSON_TOKEN_COLON) {
+            s_error_at(&token, "missing ':'");
+            return s_parse_abort(obj);
+        } else token = s_scan_token();
+
+        tjson_t* val = s_parse_json_token(&token);
+        if (!val) return s_parse_abort(obj);
+        int len = key.length - 2;
+        TJSON_STATS_ADD(string_bytes, len);
+        TJSON_STATS_PHASE(phase, TJSON_PHASE_STRING);
+        val->name = s_str_assign(val->name, key.start + 1, len);
+        TJSON_STATS_PHASE_END(phase);
+
+        /* the last of duplicated keys wins */
+        tjson_t** link = &obj->child;
+        while (*link) {
+            tjson_t* member = *link;
+            if (s_str_len(member->name) == len && !memcmp(member->name, val->name, len)) {
+                val->next = member->next;
+                if (last == member) last = val;
+                *link = val;
+                member->next = NULL;
+                tjson_delete(member);
+                break;
+            }
+            link = &member->next;
+        }
+        if (!*link) {
+            if (last) last->next = val;
+            else obj->child = val;
+            last = val;
+        }
+
+        token = s_scan_token();
+        if (token.type == TJSON_TOKEN_COMMA) {
+            token = s_scan_token();
+            if (token.type == TJSON_TOKEN_RBRACE) {
+                s_error_at(&token, "extra ','");
+                return s_parse_abort(obj);
+            }
+        } else if (token.type != TJSON_TOKEN_RBRACE) {
+            s_error_at(&token, "missing ','");
+            return s_parse_abort(obj);
+        }
+    }
+    TJSON_STATS_LEAVE();
+    return obj;
+}
+
+static tjson_t* s_parse_array() {
+    TJSON_STATS_ENTER();
+    tjson_t* array = s_parse_node(TJSON_ARRAY);
+    tjson_t* last = NULL;
+    tjson_token_t token = s_scan_token();
+    while (token.type != TJSON_TOKEN_RSQUAR) {
+        /* numbers stay packed until the first other value shows up */
+        if ((token.type == TJSON_TOKEN_NUMBER || token.type == TJSON_TOKEN_MINUS) &&
+            (array->flags & TJSON_FLAG_PACKED || !array->child)) {
+            s_packed_push(array, s_token_number(&token));
+        } else {
+            if (array->flags & TJSON_FLAG_PACKED) {
+                /* the numbers so far become nodes after all */
+                TJSON_STATS_ADD(nodes, array->packed->count);
+                TJSON_STATS_PHASE(phase, TJSON_PHASE_NODE);
+                s_array_unpack(array);
+                TJSON_STATS_PHASE_END(phase);
+                last = array->child;
+                while (last && last->next) last = last->next;
+            }
+            tjson_t* val = s_parse_json_token(&token);
+            if (!val) return s_parse_abort(array);
+            if (val->name) s_parse_clear_name(val);
+            if (last) last->next = val;
+            else array->child = val;
+            last = val;
+        }
+        token = s_scan_token();
+        if (token.type == TJSON_TOKEN_COMMA) {
+            token = s_scan_token();
+            if (token.type == TJSON_TOKEN_RSQUAR) {
+                s_error_at(&token, "extra ','");
+                return s_parse_abort(array);
+            }
+        } else if (token.type != TJSON_TOKEN_RSQUAR) {
+            s_error_at(&token, "missing ','");
+            return s_parse_abort(array);
+        }
+    }
+    if (array->flags & TJSON_FLAG_PACKED && !array->packed->count) tjson_clear(array);
+    TJSON_STATS_LEAVE();
+    return array;
+}
+
+tjson_t* s_parse_json_token(tjson_token_t *token) {
+    switch (token->type) {
+    case TJSON_TOKEN_LBRACE:
+        return s_parse_object();
+    case TJSON_TOKEN_LSQUAR:
+        return s_parse_array();
+    case TJSON_TOKEN_MINUS:
+    case TJSON_TOKEN_NUMBER:
+        return s_parse_number(token);
+    case TJSON_TOKEN_STRING:
+        return s_parse_string(token);
+    case TJSON_TOKEN_TRUE:
+        return s_parse_bool(1);
+    case TJSON_TOKEN_FALSE:
+        return s_parse_bool(0);
+    case TJSON_TOKEN_NULL:
+        return s_parse_node(TJSON_NULL);
+    case TJSON_TOKEN_ERROR:
+        s_error_at(token, token->start);
+        return NULL;
+    }
+    s_error_at(token, "unkown symbol");
+    return NULL;
+}
+
+tjson_t* s_parse_json(const char* json_str) {
+    s_init_scanner(json_str);
+    parser.hand_error = 0;
+    parser.panic_mode = 0;
+    tjson_token_t token = s_scan_token();
+    tjson_t* json = s_parse_json_token(&token);
+    if (parser.hand_error) exit(1);
+    if (json && json->name) s_parse_clear_name(json);
+    TJSON_STATS_PHASE_END(TJSON_PHASE_LINK);
+    return json;
+}
+
+/*===============*
+ *    Extract    *
+ *===============*/
+
+typedef struct {
+    tjson_path_t** paths;
+    tjson_t** out;
+    int count;
+    int matched;
+    int* live;
+} tjson_extract_t;
+
+static void s_skip_string(void) {
+    while (!is_at_end() && peek() != '"') {
+        char c = advance_scanner();
+        if (c == '\\' && !is_at_end()) advance_scanner();
+        else if (c == '\n') scanner.line++;
+    }
+    if (!is_at_end()) advance_scanner();
+}
+
+/* skips a whole object/array by bracket counting, without tokens or nodes */
+static int s_skip_container(void) {
+    int depth = 1;
+    while (depth > 0) {
+        if (is_at_end()) return 0;
+        switch (advance_scanner()) {
+            case '{':
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ']':
+                depth--;
+                break;
+            case '"':
+                s_skip_string();
+                break;
+            case '\n':
+                scanner.line++;
+                break;
+        }
+    }
+    return 1;
+}
+
+static int s_skip_value(tjson_token_t* token) {
+    switch (token->type) {
+    case TJSON_TOKEN_LBRACE:
+    case TJSON_TOKEN_LSQUAR:
+        if (s_skip_container()) return 1;
+        s_error_at(token, "unterminated value");
+        return 0;
+    case TJSON_TOKEN_MINUS:
+        s_scan_token();
+        return 1;
+    case TJSON_TOKEN_NUMBER:
+    case TJSON_TOKEN_STRING:
+    case TJSON_TOKEN_TRUE:
+    case TJSON_TOKEN_FALSE:
+    case TJSON_TOKEN_NULL:
+        return 1;
+    case TJSON_TOKEN_ERROR:
+        s_error_at(token, token->start);
+        return 0;
+    }
+    s_error_at(token, "unkown symbol");
+    return 0;
+}
+
+/* scans the ',' or closing token after a member/element */
+static int s_scan_separator(tjson_token_t* token, int close) {
+    *token = s_scan_token();
+    if (token->type == TJSON_TOKEN_COMMA) {
+        *token = s_scan_token();
+        if (token->type == close) {
+            s_error_at(token, "extra ','");
+            return 0;
+        }
+    } else if (token->type != close) {
+        s_error_at(token, "missing ','");
+        return 0;
+    }
+    return 1;
+}
+
+/* live holds the paths whose first 'depth' segments lead to this value */
+static int s_extract_value(tjson_extract_t* ex, tjson_token_t* token, int depth, const int* live, int nlive) {
+    tjson_scanner_t start_scanner = scanner;
+    tjson_token_t start_token = *token;
+    int parsed = 0;
+    int deeper = 0;
+    int i;
+
+    for (i = 0; i < nlive; i++) {
+        int id = live[i];
+        if (ex->paths[id]->count > depth) {
+            deeper = 1;
+            continue;
+        }
+        if (parsed) {
+            scanner = start_scanner;
+            *token = start_token;
+        }
+        ex->out[id] = s_parse_json_token(token);
+        if (!ex->out[id]) return 0;
+        ex->matched++;
+        parsed = 1;
+    }
+
+    if (!deeper || (token->type != TJSON_TOKEN_LBRACE && token->type != TJSON_TOKEN_LSQUAR)) {
+        return parsed ? 1 : s_skip_value(token);
+    }
+    if (parsed) {
+        scanner = start_scanner;
+        *token = start_token;
+    }
+
+    int* sub = ex->live + (depth+1) * ex->count;
+    tjson_token_t next = s_scan_token();
+    if (token->type == TJSON_TOKEN_LBRACE) {
+        while (next.type != TJSON_TOKEN_RBRACE) {
+            if (next.type != TJSON_TOKEN_STRING) {
+                s_error_at(&next, "expected key");
+                return 0;
+            }
+            const char* key = next.start + 1;
+            int len = next.length - 2;
+            int nsub = 0;
+            for (i = 0; i < nlive; i++) {
+                tjson_path_t* path = ex->paths[live[i]];
+                if (path->count <= depth) continue;
+                tjson_segment_t* seg = &path->segments[depth];
+                if (seg->length == len && !memcmp(seg->key, key, len)) sub[nsub++] = live[i];
+            }
+
+            next = s_scan_token();
+            if (next.type != TJSON_TOKEN_COLON) {
+                s_error_at(&next, "missing ':'");
+                return 0;
+            }
+            next = s_scan_token();
+            if (nsub) {
+                if (!s_extract_value(ex, &next, depth+1, sub, nsub)) return 0;
+            } else if (!s_skip_value(&next)) return 0;
+
+            if (!s_scan_separator(&next, TJSON_TOKEN_RBRACE)) return 0;
+        }
+    } else {
+        int index = 0;
+        while (next.type != TJSON_TOKEN_RSQUAR) {
+            int nsub = 0;
+            for (i = 0; i < nlive; i++) {
+                tjson_path_t* path = ex->paths[live[i]];
+                if (path->count > depth && path->segments[depth].index == index) sub[nsub++] = live[i];
+            }
+
+            if (nsub) {
+                if (!s_extract_value(ex, &next, depth+1, sub, nsub)) return 0;
+            } else if (!s_skip_value(&next)) return 0;
+
+            if (!s_scan_separator(&next, TJSON_TOKEN_RSQUAR)) return 0;
+            index++;
+        }
+    }
+
+    return 1;
+}
+
+int tjson_extract(const char* json_str, tjson_path_t** paths, int count, tjson_t** out) {
+    if (!json_str || !paths || !out || count <= 0) return -1;
+
+    int max_depth = 0;
+    int i;
+    for (i = 0; i < count; i++) {
+        out[i] = NULL;
+        if (!paths[i]) return -1;
+        if (paths[i]->count > max_depth) max_depth = paths[i]->count;
+    }
+
+    /* one list of live path ids per depth */
+    int stack_live[64];
+    tjson_extract_t ex;
+    ex.paths = paths;
+    ex.out = out;
+    ex.count = count;
+    ex.matched = 0;
+    ex.live = stack_live;
+    if ((max_depth+1) * count > 64) {
+        ex.live = (int*)s_malloc((max_depth+1) * count * sizeof(int));
+        if (!ex.live) return -1;
+    }
+    for (i = 0; i < count; i++) ex.live[i] = i;
+
+    s_init_scanner(json_str);
+    parser.hand_error = 0;
+    parser.panic_mode = 0;
+    tjson_token_t token = s_scan_token();
+    int ok = s_extract_value(&ex, &token, 0, ex.live, count);
+
+    if (ex.live != stack_live) s_free(ex.live);
+    if (!ok) {
+        for (i = 0; i < count; i++) {
+            tjson_delete(out[i]);
+            out[i] = NULL;
+        }
+        return -1;
+    }
+    return ex.matched;
+}
+
+/*===============*
+ *    Binding    *
+ *===============*/
+
+static int s_bind_object(const tjson_field_t* fields, char* out);
+static void s_bind_free_items(const tjson_field_t* field, char* items, int count);
+static void s_bind_free_field(const tjson_field_t* field, char* out);
+
+static void s_bind_int(char* dst, size_t size, long value) {
+    if (size == sizeof(int)) *(int*)dst = (int)value;
+    else if (size == sizeof(long)) *(long*)dst = value;
+    else if (size == sizeof(short)) *(short*)dst = (short)value;
+    else if (size == sizeof(signed char)) *(signed char*)dst = (signed char)value;
+}
+
+static int s_bind_element(tjson_token_t* token, const tjson_field_t* field, char* dst) {
+    int is_number = token->type == TJSON_TOKEN_NUMBER || token->type == TJSON_TOKEN_MINUS;
+    int is_bool = token->type == TJSON_TOKEN_TRUE || token->type == TJSON_TOKEN_FALSE;
+
+    switch (field->type) {
+    case TJSON_BIND_INT:
+        if (!is_number) break;
+        s_bind_int(dst, field->size, (long)s_token_number(token));
+        return 1;
+    case TJSON_BIND_FLOAT:
+        if (!is_number) break;
+        *(float*)dst = (float)s_token_number(token);
+        return 1;
+    case TJSON_BIND_DOUBLE:
+        if (!is_number) break;
+        *(double*)dst = s_token_number(token);
+        return 1;
+    case TJSON_BIND_BOOL:
+        if (!is_bool) break;
+        s_bind_int(dst, field->size, token->type == TJSON_TOKEN_TRUE);
+        return 1;
+    case TJSON_BIND_STRING:
+        if (token->type != TJSON_TOKEN_STRING) break;
+        /* a repeated key replaces the earlier string */
+        s_free(*(char**)dst);
+        *(char**)dst = s_parse_cstring(token);
+        return 1;
+    case TJSON_BIND_CHARS:
+        if (token->type != TJSON_TOKEN_STRING || field->size == 0) break;
+        {
+            size_t len = token->length - 2;
+            if (len > field->size - 1) len = field->size - 1;
+            memcpy(dst, token->start + 1, len);
+            dst[len] = '\0';
+        }
+        return 1;
+    case TJSON_BIND_STRUCT:
+        if (token->type != TJSON_TOKEN_LBRACE) break;
+        return s_bind_object(field->fields, dst);
+    default:
+        break;
+    }
+    return s_skip_value(token);
+}
+
+static int s_bind_array(tjson_token_t* token, const tjson_field_t* field, char* dst) {
+    if (token->type != TJSON_TOKEN_LSQUAR) return s_skip_value(token);
+
+    char* items = dst;
+    int capacity = field->count;
+    int count = 0;
+    if (field->count == TJSON_BIND_DYNAMIC) {
+        items = NULL;
+        capacity = 0;
+    }
+
+    tjson_token_t next = s_scan_token();
+    while (next.type != TJSON_TOKEN_RSQUAR) {
+        if (field->count == TJSON_BIND_DYNAMIC && count == capacity) {
+            int grow = capacity ? capacity * 2 : 8;
+            char* resized = (char*)s_realloc(items, grow * field->size);
+            if (!resized) {
+                s_bind_free_items(field, items, count);
+                s_free(items);
+                return 0;
+            }
+            memset(resized + capacity * field->size, 0, (grow - capacity) * field->size);
+            items = resized;
+            capacity = grow;
+        }
+
+        int ok;
+        if (count < capacity) ok = s_bind_element(&next, field, items + count * field->size);
+        else ok = s_skip_value(&next);
+        count++;
+
+        if (!ok || !s_scan_separator(&next, TJSON_TOKEN_RSQUAR)) {
+            /* the elements bound so far, and what the failed one got */
+            if (field->count == TJSON_BIND_DYNAMIC) {
+                s_bind_free_items(field, items, count < capacity ? count : capacity);
+                s_free(items);
+            }
+            return 0;
+        }
+    }
+
+    if (field->count == TJSON_BIND_DYNAMIC) {
+        s_bind_free_field(field, dst - field->offset);
+        *(char**)dst = items;
+        *(int*)(dst - field->offset + field->count_offset) = count;
+    }
+    return 1;
+}
+
+static int s_bind_object(const tjson_field_t* fields, char* out) {
+    tjson_token_t token = s_scan_token();
+    while (token.type != TJSON_TOKEN_RBRACE) {
+        if (token.type != TJSON_TOKEN_STRING) {
+            s_error_at(&token, "expected key");
+            return 0;
+        }
+        const char* key = token.start + 1;
+        int len = token.length - 2;
+        const tjson_field_t* field;
+        for (field = fields; field->key; field++) {
+            if (!strncmp(field->key, key, len) && field->key[len] == '\0') break;
+        }
+
+        token = s_scan_token();
+        if (token.type != TJSON_TOKEN_COLON) {
+            s_error_at(&token, "missing ':'");
+            return 0;
+        }
+        token = s_scan_token();
+
+        int ok;
+        if (!field->key) ok = s_skip_value(&token);
+        else if (field->count != 0) ok = s_bind_array(&token, field, out + field->offset);
+        else ok = s_bind_element(&token, field, out + field->offset);
+        if (!ok || !s_scan_separator(&token, TJSON_TOKEN_RBRACE)) return 0;
     }
-    return s_error_token("Unexpected character");
+    return 1;
+}
+
+int tjson_bind(const char* json_str, const tjson_field_t* fields, void* out) {
+    if (!json_str || !fields || !out) return -1;
+
+    s_init_scanner(json_str);
+    parser.hand_error = 0;
+    parser.panic_mode = 0;
+    tjson_token_t token = s_scan_token();
+    if (token.type != TJSON_TOKEN_LBRACE) {
+        s_error_at(&token, "expected object");
+        return -1;
+    }
+    return s_bind_object(fields, (char*)out) ? 0 : -1;
+}
+
+int tjson_bind_file(const char* filename, const tjson_field_t* fields, void* out) {
+    char* source = s_file_read(filename);
+    if (!source) return -1;
+    int res = tjson_bind(source, fields, out);
+    s_free(source);
+    return res;
+}
+
+static void s_bind_free_items(const tjson_field_t* field, char* items, int count) {
+    int i;
+    for (i = 0; i < count; i++) {
+        char* item = items + i * field->size;
+        if (field->type == TJSON_BIND_STRING) {
+            s_free(*(char**)item);
+            *(char**)item = NULL;
+        } else if (field->type == TJSON_BIND_STRUCT) tjson_bind_free(field->fields, item);
+    }
+}
+
+static void s_bind_free_field(const tjson_field_t* field, char* out) {
+    char* dst = out + field->offset;
+    char* items = dst;
+    int count = field->count ? field->count : 1;
+    if (field->count == TJSON_BIND_DYNAMIC) {
+        items = *(char**)dst;
+        count = items ? *((int*)(out + field->count_offset)) : 0;
+    }
+
+    s_bind_free_items(field, items, count);
+
+    if (field->count == TJSON_BIND_DYNAMIC) {
+        s_free(items);
+        *(char**)dst = NULL;
+        *((int*)(out + field->count_offset)) = 0;
+    }
+}
+
+void tjson_bind_free(const tjson_field_t* fields, void* out) {
+    if (!fields || !out) return;
+
+    const tjson_field_t* field;
+    for (field = fields; field->key; field++) s_bind_free_field(field, (char*)out);
 }
 
 /*==============*
- *    Parser    *
+ *    Binary    *
  *==============*/
 
-static void s_error_at(tjson_token_t* token, const char* message) {
-    if (parser.panic_mode) return;
-    parser.panic_mode = 1;
-    fprintf(stderr, "[tinyjson]:%d Error", token->line);
-    if (token->type == TJSON_TOKEN_EOF) fprintf(stderr, " at end");
-    else fprintf(stderr, " at %.*s,", token->length, token->start);
-    fprintf(stderr, " %s\n", message);
-    parser.hand_error = 1;
+#define TJSON_BINARY_MAGIC "TJSB"
+#define TJSON_BINARY_VERSION 2
+#define TJSON_BINARY_HEADER 16
+
+/* Header: magic, version, byte order of the doubles (1 little, 2 big), two
+ * zero bytes, then the string table and values sizes as little endian u32.
+ *
+ * The string table holds [varint length][bytes]['\0'] entries and the
+ * doubles of packed arrays, 8 byte aligned; refs are offsets into it.
+ *
+ * Values start with the root name ref + 1 (0 is none). Each value is a kind
+ * byte and its payload, members of objects are preceded by their name ref.
+ * Arrays, objects and integer arrays give their count and size in bytes, so
+ * views can step over them. */
+#define TJSON_BIN_ROOT -1
+#define TJSON_BIN_NULL 0
+#define TJSON_BIN_FALSE 1
+#define TJSON_BIN_TRUE 2
+#define TJSON_BIN_UINT 3    /* varint */
+#define TJSON_BIN_NINT 4    /* varint of the magnitude */
+#define TJSON_BIN_DOUBLE 5  /* 8 bytes */
+#define TJSON_BIN_STRING 6  /* varint ref */
+#define TJSON_BIN_ARRAY 7   /* varint count, varint size, values */
+#define TJSON_BIN_OBJECT 8  /* varint count, varint size, members */
+#define TJSON_BIN_DOUBLES 9 /* varint count, varint ref of the doubles */
+#define TJSON_BIN_INTS 10   /* varint count, varint size, zigzag varints */
+#define TJSON_BIN_ZIGZAG 11 /* element of TJSON_BIN_INTS, never a kind byte */
+
+static int s_varint_size(unsigned long long value) {
+    int size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
 }
 
-#if 0
-static void s_error_at_current(const char* message) {
-    s_error_at(&parser.current, message);
+static unsigned char* s_varint_put(unsigned char* p, unsigned long long value) {
+    while (value >= 0x80) {
+        *p++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (unsigned char)value;
+    return p;
 }
-#endif
 
-static char* s_parse_cstring(tjson_token_t* token) {
-    int len = token->length;
-    char* string = (char*)malloc(len-1);
-    memcpy(string, token->start+1, len-2);
-    string[len-2] = '\0';
-    return string;
+/* NULL when the varint runs past 'end' or over 64 bits */
+static const unsigned char* s_varint_get(const unsigned char* p, const unsigned char* end, unsigned long long* value) {
+    int shift;
+    *value = 0;
+    for (shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char byte = *p++;
+        *value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return p;
+    }
+    return NULL;
 }
 
-static tjson_t* s_parse_number(tjson_token_t* token) {
-    double value = 0;
-    if (token->type == TJSON_TOKEN_MINUS) {
-        tjson_token_t tnext = s_scan_token();
-        value = -strtod(tnext.start, NULL);
+static unsigned int s_binary_u32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static void s_binary_put_u32(unsigned char* p, unsigned int value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+}
+
+static int s_binary_order(void) {
+    unsigned int one = 1;
+    return *(unsigned char*)&one ? 1 : 2;
+}
+
+/* integral numbers up to 2^53 are stored as varints, -0.0 stays a double */
+static int s_binary_integral(double number, unsigned long long* magnitude) {
+    double zero = 0.0;
+    if (!(number >= -9007199254740992.0 && number <= 9007199254740992.0)) return 0;
+    if (number == 0) {
+        *magnitude = 0;
+        return !memcmp(&number, &zero, sizeof(double));
     }
-    else value = strtod(token->start, NULL);
-    return tjson_create_number(value);
+    double positive = number < 0 ? -number : number;
+    *magnitude = (unsigned long long)positive;
+    return (double)*magnitude == positive;
 }
 
-static tjson_t* s_parse_string(tjson_token_t* token) {
-    char* str = s_parse_cstring(token);
-    return tjson_create_string(str);
+static unsigned long long s_binary_zigzag(double number) {
+    unsigned long long magnitude;
+    s_binary_integral(number, &magnitude);
+    return number < 0 ? magnitude * 2 - 1 : magnitude * 2;
 }
 
-static tjson_t* s_parse_json_token(tjson_token_t* token);
+static int s_binary_ints(const double* numbers, int count) {
+    unsigned long long magnitude;
+    int i;
+    for (i = 0; i < count; i++)
+        if (!s_binary_integral(numbers[i], &magnitude)) return 0;
+    return 1;
+}
 
-static tjson_t* s_parse_object() {
-    tjson_t* obj = tjson_create_object();
-    tjson_token_t token = s_scan_token();
-    while (token.type != TJSON_TOKEN_RBRACE) {
-        char* name = s_parse_cstring(&token);
-        token = s_scan_token();
-        if (token.type != TJSON_TOKEN_COLON) {
-            s_error_at(&token, "missing ':'");
-            exit(1);
-        } else token = s_scan_token();
+typedef struct {
+    unsigned char* table;
+    size_t table_size;
+    size_t table_capacity;
+    unsigned int* slots; /* string hash, table offset + 1, 0 is empty */
+    unsigned int slots_mask;
+    size_t* sizes;       /* per array/object in pre-order: size in bytes, or ref of the doubles */
+    unsigned int next;
+    int failed;
+} tjson_encoder_t;
+
+static void s_binary_count(tjson_t* json, unsigned int* nodes) {
+    (*nodes)++;
+    if ((json->type == TJSON_ARRAY || json->type == TJSON_OBJECT) && !(json->flags & TJSON_FLAG_PACKED)) {
+        tjson_t* el = NULL;
+        tjson_foreach(el, json) s_binary_count(el, nodes);
+    }
+}
 
-        tjson_t* val = s_parse_json_token(&token);
-        tjson_object_set(obj, name, val);
+static unsigned char* s_binary_reserve(tjson_encoder_t* enc, size_t size) {
+    if (enc->table_size + size > enc->table_capacity) {
+        size_t capacity = enc->table_capacity ? enc->table_capacity : 256;
+        while (capacity < enc->table_size + size) capacity *= 2;
+        unsigned char* table = (unsigned char*)s_realloc(enc->table, capacity);
+        if (!table) {
+            enc->failed = 1;
+            return NULL;
+        }
+        enc->table = table;
+        enc->table_capacity = capacity;
+    }
+    return enc->table + enc->table_size;
+}
 
-        token = s_scan_token();
-        if (token.type == TJSON_TOKEN_COMMA) {
-            token = s_scan_token();
-            if (token.type == TJSON_TOKEN_RBRACE) {
-                s_error_at(&token, "extra ','");
-                exit(1);
+/* ref of the string, added to the table the first time it's seen */
+static size_t s_binary_string(tjson_encoder_t* enc, const char* str) {
+    unsigned int len = str ? (unsigned int)s_str_len(str) : 0;
+    unsigned int hash = 2166136261u;
+    unsigned int i;
+    for (i = 0; i < len; i++) hash = (hash ^ (unsigned char)str[i]) * 16777619u;
+
+    unsigned int slot = hash & enc->slots_mask;
+    while (enc->slots[slot]) {
+        size_t offset = enc->slots[slot] - 1;
+        unsigned long long other;
+        const unsigned char* bytes = s_varint_get(enc->table + offset, enc->table + enc->table_size, &other);
+        if (other == len && !memcmp(bytes, str, len)) return offset;
+        slot = (slot + 1) & enc->slots_mask;
+    }
+
+    unsigned char* p = s_binary_reserve(enc, s_varint_size(len) + len + 1);
+    if (!p) return 0;
+    size_t offset = enc->table_size;
+    p = s_varint_put(p, len);
+    if (len) memcpy(p, str, len);
+    p[len] = '\0';
+    enc->table_size = p + len + 1 - enc->table;
+    enc->slots[slot] = (unsigned int)offset + 1;
+    return offset;
+}
+
+static size_t s_binary_doubles(tjson_encoder_t* enc, const double* numbers, int count) {
+    size_t pad = (sizeof(double) - enc->table_size % sizeof(double)) % sizeof(double);
+    unsigned char* p = s_binary_reserve(enc, pad + count * sizeof(double));
+    if (!p) return 0;
+    memset(p, 0, pad);
+    memcpy(p + pad, numbers, count * sizeof(double));
+    enc->table_size += pad + count * sizeof(double);
+    return enc->table_size - count * sizeof(double);
+}
+
+/* bytes of the encoded value, filling the string table and enc->sizes */
+static size_t s_binary_measure(tjson_encoder_t* enc, tjson_t* json, int member) {
+    size_t size = 1;
+    unsigned long long magnitude;
+    if (member) size += s_varint_size(s_binary_string(enc, json->name));
+    switch (json->type) {
+        case TJSON_NUMBER:
+            size += s_binary_integral(json->number, &magnitude) ? s_varint_size(magnitude) : sizeof(double);
+            break;
+        case TJSON_STRING:
+            size += s_varint_size(s_binary_string(enc, json->string));
+            break;
+        case TJSON_ARRAY:
+        case TJSON_OBJECT: {
+            unsigned int index = enc->next++;
+            size_t content = 0;
+            int count = 0;
+            if (json->flags & TJSON_FLAG_PACKED) {
+                const double* numbers = TJSON_PACKED_DATA(json->packed);
+                count = json->packed->count;
+                if (!s_binary_ints(numbers, count)) {
+                    enc->sizes[index] = s_binary_doubles(enc, numbers, count);
+                    size += s_varint_size(count) + s_varint_size(enc->sizes[index]);
+                    break;
+                }
+                int i;
+                for (i = 0; i < count; i++) content += s_varint_size(s_binary_zigzag(numbers[i]));
+            } else {
+                tjson_t* el = NULL;
+                tjson_foreach(el, json) {
+                    content += s_binary_measure(enc, el, json->type == TJSON_OBJECT);
+                    count++;
+                }
             }
-        } else if (token.type != TJSON_TOKEN_RBRACE) {
-            s_error_at(&token, "missing ','");
-            exit(1);
+            enc->sizes[index] = content;
+            size += s_varint_size(count) + s_varint_size(content) + content;
+        } break;
+    }
+    return size;
+}
+
+static unsigned char* s_binary_put(tjson_encoder_t* enc, tjson_t* json, int member, unsigned char* p) {
+    unsigned long long magnitude;
+    if (member) p = s_varint_put(p, s_binary_string(enc, json->name));
+    switch (json->type) {
+        case TJSON_NULL:
+            *p++ = TJSON_BIN_NULL;
+            break;
+        case TJSON_BOOL:
+            *p++ = json->boolean ? TJSON_BIN_TRUE : TJSON_BIN_FALSE;
+            break;
+        case TJSON_NUMBER:
+            if (s_binary_integral(json->number, &magnitude)) {
+                *p++ = json->number < 0 ? TJSON_BIN_NINT : TJSON_BIN_UINT;
+                p = s_varint_put(p, magnitude);
+            } else {
+                *p++ = TJSON_BIN_DOUBLE;
+                memcpy(p, &json->number, sizeof(double));
+                p += sizeof(double);
+            }
+            break;
+        case TJSON_STRING:
+            *p++ = TJSON_BIN_STRING;
+            p = s_varint_put(p, s_binary_string(enc, json->string));
+            break;
+        case TJSON_ARRAY:
+        case TJSON_OBJECT: {
+            size_t size = enc->sizes[enc->next++];
+            if (json->flags & TJSON_FLAG_PACKED) {
+                const double* numbers = TJSON_PACKED_DATA(json->packed);
+                int count = json->packed->count;
+                int ints = s_binary_ints(numbers, count);
+                int i;
+                *p++ = ints ? TJSON_BIN_INTS : TJSON_BIN_DOUBLES;
+                p = s_varint_put(p, count);
+                p = s_varint_put(p, size);
+                if (ints)
+                    for (i = 0; i < count; i++) p = s_varint_put(p, s_binary_zigzag(numbers[i]));
+            } else {
+                tjson_t* el = NULL;
+                int count = 0;
+                tjson_foreach(el, json) count++;
+                *p++ = json->type == TJSON_ARRAY ? TJSON_BIN_ARRAY : TJSON_BIN_OBJECT;
+                p = s_varint_put(p, count);
+                p = s_varint_put(p, size);
+                tjson_foreach(el, json) p = s_binary_put(enc, el, json->type == TJSON_OBJECT, p);
+            }
+        } break;
+    }
+    return p;
+}
+
+void* tjson_encode(tjson_t* json, size_t* size) {
+    if (!json) return NULL;
+
+    unsigned int nodes = 0;
+    s_binary_count(json, &nodes);
+
+    unsigned int slots = 16;
+    while (slots < nodes * 4) slots <<= 1;
+    tjson_encoder_t enc;
+    memset(&enc, 0, sizeof(enc));
+    enc.slots_mask = slots - 1;
+    enc.slots = (unsigned int*)s_malloc(slots * sizeof(unsigned int));
+    enc.sizes = (size_t*)s_malloc(nodes * sizeof(size_t));
+    unsigned char* data = NULL;
+    if (enc.slots && enc.sizes) {
+        memset(enc.slots, 0, slots * sizeof(unsigned int));
+        size_t root_name = json->name ? s_binary_string(&enc, json->name) + 1 : 0;
+        size_t values = s_varint_size(root_name) + s_binary_measure(&enc, json, 0);
+        if (!enc.failed && enc.table_size <= 0xffffffffu && values <= 0xffffffffu)
+            data = (unsigned char*)s_malloc(TJSON_BINARY_HEADER + enc.table_size + values);
+        if (data) {
+            memcpy(data, TJSON_BINARY_MAGIC, 4);
+            data[4] = TJSON_BINARY_VERSION;
+            data[5] = (unsigned char)s_binary_order();
+            data[6] = data[7] = 0;
+            s_binary_put_u32(data + 8, (unsigned int)enc.table_size);
+            s_binary_put_u32(data + 12, (unsigned int)values);
+            if (enc.table_size) memcpy(data + TJSON_BINARY_HEADER, enc.table, enc.table_size);
+            enc.next = 0;
+            unsigned char* p = s_varint_put(data + TJSON_BINARY_HEADER + enc.table_size, root_name);
+            s_binary_put(&enc, json, 0, p);
+            if (size) *size = TJSON_BINARY_HEADER + enc.table_size + values;
         }
     }
-    return obj;
+    s_free(enc.table);
+    s_free(enc.slots);
+    s_free(enc.sizes);
+    return data;
 }
 
-static tjson_t* s_parse_array() {
-    tjson_t* array = tjson_create_array();
-    tjson_token_t token = s_scan_token();
-    while (token.type != TJSON_TOKEN_RSQUAR) {
-        tjson_t* val = s_parse_json_token(&token);
-        tjson_array_push(array, val);
-        token = s_scan_token();
-        if (token.type == TJSON_TOKEN_COMMA) {
-            token = s_scan_token();
-            if (token.type == TJSON_TOKEN_RSQUAR) {
-                s_error_at(&token, "extra ','");
-                exit(1);
+static const char* s_view_string(const unsigned char* image, unsigned long long ref, int* length) {
+    const unsigned char* table = image + TJSON_BINARY_HEADER;
+    const unsigned char* end = table + s_binary_u32(image + 8);
+    unsigned long long len;
+    if (ref >= (size_t)(end - table)) return NULL;
+    const unsigned char* p = s_varint_get(table + ref, end, &len);
+    if (!p || len >= (size_t)(end - p) || p[len]) return NULL;
+    if (length) *length = (int)len;
+    return (const char*)p;
+}
+
+static const unsigned char* s_view_doubles(const unsigned char* image, unsigned long long ref, unsigned long long count) {
+    size_t table = s_binary_u32(image + 8);
+    if (ref > table || ref % sizeof(double) || count > (table - ref) / sizeof(double)) return NULL;
+    return image + TJSON_BINARY_HEADER + ref;
+}
+
+/* end of the value's payload, NULL if it runs past view->end */
+static const unsigned char* s_view_skip(const tjson_view_t* view) {
+    const unsigned char* p = view->at;
+    unsigned long long count, size;
+    switch (view->kind) {
+        case TJSON_BIN_NULL:
+        case TJSON_BIN_FALSE:
+        case TJSON_BIN_TRUE:
+            return p;
+        case TJSON_BIN_UINT:
+        case TJSON_BIN_NINT:
+        case TJSON_BIN_ZIGZAG:
+        case TJSON_BIN_STRING:
+            return s_varint_get(p, view->end, &count);
+        case TJSON_BIN_DOUBLE:
+            return (size_t)(view->end - p) >= sizeof(double) ? p + sizeof(double) : NULL;
+        case TJSON_BIN_DOUBLES:
+            p = s_varint_get(p, view->end, &count);
+            return p ? s_varint_get(p, view->end, &size) : NULL;
+        default:
+            p = s_varint_get(p, view->end, &count);
+            if (p) p = s_varint_get(p, view->end, &size);
+            return p && size <= (size_t)(view->end - p) ? p + size : NULL;
+    }
+}
+
+/* points 'view' at the value starting at 'p', 0 if it is malformed */
+static int s_view_load(tjson_view_t* view, const unsigned char* p, const unsigned char* end, int parent) {
+    unsigned long long ref;
+    view->end = end;
+    view->parent = parent;
+    view->name = NULL;
+    if (parent == TJSON_BIN_INTS || parent == TJSON_BIN_DOUBLES) {
+        view->kind = parent == TJSON_BIN_INTS ? TJSON_BIN_ZIGZAG : TJSON_BIN_DOUBLE;
+        view->at = p;
+        return p < end && s_view_skip(view) != NULL;
+    }
+    if (parent == TJSON_BIN_OBJECT) {
+        p = s_varint_get(p, end, &ref);
+        if (!p || !(view->name = s_view_string(view->image, ref, NULL))) return 0;
+    }
+    if (p >= end || *p > TJSON_BIN_INTS) return 0;
+    view->kind = *p;
+    view->at = p + 1;
+    return s_view_skip(view) != NULL;
+}
+
+int tjson_view_open(tjson_view_t* root, const void* data, size_t size) {
+    const unsigned char* image = (const unsigned char*)data;
+    if (!root) return -1;
+    if (!image || size < TJSON_BINARY_HEADER || memcmp(image, TJSON_BINARY_MAGIC, 4) ||
+        image[4] != TJSON_BINARY_VERSION || image[5] != s_binary_order()) {
+        fprintf(stderr, "[tinyjson]: invalid binary image\n");
+        return -1;
+    }
+    if ((size_t)image % sizeof(double)) {
+        fprintf(stderr, "[tinyjson]: binary image not 8 byte aligned\n");
+        return -1;
+    }
+    size_t table = s_binary_u32(image + 8);
+    size_t values = s_binary_u32(image + 12);
+    if (table > size - TJSON_BINARY_HEADER || values > size - TJSON_BINARY_HEADER - table) {
+        fprintf(stderr, "[tinyjson]: truncated binary image\n");
+        return -1;
+    }
+
+    const unsigned char* p = image + TJSON_BINARY_HEADER + table;
+    const unsigned char* end = p + values;
+    const char* name = NULL;
+    unsigned long long ref;
+    root->image = image;
+    p = s_varint_get(p, end, &ref);
+    if (!p || (ref && !(name = s_view_string(image, ref - 1, NULL))) || !s_view_load(root, p, end, TJSON_BIN_ROOT)) {
+        fprintf(stderr, "[tinyjson]: corrupted binary image\n");
+        return -1;
+    }
+    root->name = name;
+    return 0;
+}
+
+TJSON_TYPE_ tjson_view_type(const tjson_view_t* view) {
+    if (!view) return TJSON_NULL;
+    switch (view->kind) {
+        case TJSON_BIN_FALSE:
+        case TJSON_BIN_TRUE:
+            return TJSON_BOOL;
+        case TJSON_BIN_UINT:
+        case TJSON_BIN_NINT:
+        case TJSON_BIN_DOUBLE:
+        case TJSON_BIN_ZIGZAG:
+            return TJSON_NUMBER;
+        case TJSON_BIN_STRING:
+            return TJSON_STRING;
+        case TJSON_BIN_ARRAY:
+        case TJSON_BIN_DOUBLES:
+        case TJSON_BIN_INTS:
+            return TJSON_ARRAY;
+        case TJSON_BIN_OBJECT:
+            return TJSON_OBJECT;
+    }
+    return TJSON_NULL;
+}
+
+const char* tjson_view_name(const tjson_view_t* view) { return view ? view->name : NULL; }
+
+double tjson_view_number(const tjson_view_t* view) {
+    unsigned long long value;
+    double number;
+    if (!view) return TJSON_NUMBER_ERROR;
+    switch (view->kind) {
+        case TJSON_BIN_UINT:
+            s_varint_get(view->at, view->end, &value);
+            return (double)value;
+        case TJSON_BIN_NINT:
+            s_varint_get(view->at, view->end, &value);
+            return -(double)value;
+        case TJSON_BIN_ZIGZAG:
+            s_varint_get(view->at, view->end, &value);
+            return value & 1 ? -(double)(value >> 1) - 1 : (double)(value >> 1);
+        case TJSON_BIN_DOUBLE:
+            memcpy(&number, view->at, sizeof(double));
+            return number;
+    }
+    return TJSON_NUMBER_ERROR;
+}
+
+int tjson_view_bool(const tjson_view_t* view) { return view && view->kind == TJSON_BIN_TRUE; }
+
+const char* tjson_view_string(const tjson_view_t* view, int* length) {
+    unsigned long long ref;
+    if (!view || view->kind != TJSON_BIN_STRING) return NULL;
+    s_varint_get(view->at, view->end, &ref);
+    return s_view_string(view->image, ref, length);
+}
+
+int tjson_view_count(const tjson_view_t* view) {
+    unsigned long long count;
+    if (!view || tjson_view_type(view) < TJSON_ARRAY) return 0;
+    s_varint_get(view->at, view->end, &count);
+    return count > 0x7fffffff ? 0 : (int)count;
+}
+
+int tjson_view_child(const tjson_view_t* view, tjson_view_t* out) {
+    unsigned long long count, size;
+    if (!view || !out || tjson_view_type(view) < TJSON_ARRAY) return 0;
+    const unsigned char* p = s_varint_get(view->at, view->end, &count);
+    p = s_varint_get(p, view->end, &size);
+    if (!count) return 0;
+
+    const unsigned char* end;
+    if (view->kind == TJSON_BIN_DOUBLES) {
+        if (!(p = s_view_doubles(view->image, size, count))) return 0;
+        end = p + count * sizeof(double);
+    } else {
+        end = p + size;
+    }
+    tjson_view_t child;
+    child.image = view->image;
+    if (!s_view_load(&child, p, end, view->kind)) return 0;
+    *out = child;
+    return 1;
+}
+
+int tjson_view_next(tjson_view_t* view) {
+    if (!view || view->parent == TJSON_BIN_ROOT) return 0;
+    const unsigned char* p = s_view_skip(view);
+    if (!p || p >= view->end) return 0;
+    tjson_view_t next = *view;
+    if (!s_view_load(&next, p, view->end, view->parent)) return 0;
+    *view = next;
+    return 1;
+}
+
+int tjson_view_get(const tjson_view_t* object, const char* name, tjson_view_t* out) {
+    tjson_view_t child;
+    if (!object || !name || object->kind != TJSON_BIN_OBJECT || !tjson_view_child(object, &child)) return 0;
+    do {
+        if (!strcmp(child.name, name)) {
+            if (out) *out = child;
+            return 1;
+        }
+    } while (tjson_view_next(&child));
+    return 0;
+}
+
+int tjson_view_at(const tjson_view_t* array, int index, tjson_view_t* out) {
+    tjson_view_t child;
+    if (!array || index < 0 || tjson_view_type(array) != TJSON_ARRAY || !tjson_view_child(array, &child)) return 0;
+    if (array->kind == TJSON_BIN_DOUBLES) {
+        if (index >= tjson_view_count(array)) return 0;
+        child.at += (size_t)index * sizeof(double);
+    } else {
+        while (index-- > 0)
+            if (!tjson_view_next(&child)) return 0;
+    }
+    if (out) *out = child;
+    return 1;
+}
+
+const double* tjson_view_numbers(const tjson_view_t* array, int* count) {
+    unsigned long long n, ref;
+    if (!array || array->kind != TJSON_BIN_DOUBLES) return NULL;
+    const unsigned char* p = s_varint_get(array->at, array->end, &n);
+    s_varint_get(p, array->end, &ref);
+    const unsigned char* numbers = s_view_doubles(array->image, ref, n);
+    if (numbers && count) *count = (int)n;
+    return (const double*)numbers;
+}
+
+tjson_t* tjson_view_decode(const tjson_view_t* view) {
+    if (!view || !view->image) return NULL;
+    tjson_t* json = tjson_create(tjson_view_type(view));
+    if (!json) return NULL;
+    if (view->name && !(json->name = s_str_assign(NULL, view->name, (int)strlen(view->name)))) {
+        tjson_delete(json);
+        return NULL;
+    }
+
+    int count = tjson_view_count(view);
+    int found = 0;
+    tjson_view_t child;
+    switch (json->type) {
+        case TJSON_NUMBER:
+            json->number = tjson_view_number(view);
+            break;
+        case TJSON_BOOL:
+            json->boolean = tjson_view_bool(view);
+            break;
+        case TJSON_STRING: {
+            int len;
+            const char* str = tjson_view_string(view, &len);
+            if (!str || !(json->string = s_str_assign(NULL, str, len))) found = -1;
+        } break;
+        case TJSON_ARRAY:
+        case TJSON_OBJECT:
+            if (view->kind == TJSON_BIN_DOUBLES || view->kind == TJSON_BIN_INTS) {
+                const double* numbers = tjson_view_numbers(view, NULL);
+                tjson_packed_t* packed = NULL;
+                /* every integer takes at least a byte, check before allocating */
+                if (view->kind == TJSON_BIN_DOUBLES ? numbers != NULL : (size_t)count <= (size_t)(view->end - view->at))
+                    packed = count ? s_packed_reserve(json, count) : NULL;
+                if (!packed) {
+                    found = count ? -1 : 0;
+                } else if (numbers) {
+                    memcpy(TJSON_PACKED_DATA(packed), numbers, count * sizeof(double));
+                    found = packed->count = count;
+                } else if (tjson_view_child(view, &child)) {
+                    do {
+                        if (found == count) break;
+                        TJSON_PACKED_DATA(packed)[found++] = tjson_view_number(&child);
+                    } while (tjson_view_next(&child));
+                    packed->count = found;
+                }
+                if (found != count) found = -1;
+            } else if (tjson_view_child(view, &child)) {
+                tjson_t* last = NULL;
+                do {
+                    tjson_t* el = found < count ? tjson_view_decode(&child) : NULL;
+                    if (!el) break;
+                    if (last) last->next = el;
+                    else json->child = el;
+                    last = el;
+                    found++;
+                } while (tjson_view_next(&child));
             }
-        } else if (token.type != TJSON_TOKEN_RSQUAR) {
-            s_error_at(&token, "missing ','");
-            exit(1);
+            if (found != count) found = -1;
+            break;
+    }
+    if (found < 0) {
+        tjson_delete(json);
+        return NULL;
+    }
+    return json;
+}
+
+tjson_t* tjson_decode(const void* data, size_t size) {
+    tjson_view_t root;
+    void* copy = NULL;
+    /* views need aligned doubles, copy buffers that don't have them */
+    if (data && (size_t)data % sizeof(double)) {
+        copy = s_malloc(size);
+        if (!copy) return NULL;
+        memcpy(copy, data, size);
+        data = copy;
+    }
+    tjson_t* json = NULL;
+    if (!tjson_view_open(&root, data, size)) {
+        json = tjson_view_decode(&root);
+        if (!json) fprintf(stderr, "[tinyjson]: corrupted binary image\n");
+    }
+    s_free(copy);
+    return json;
+}
+
+int tjson_save_binary(tjson_t* json, const char* filename) {
+    size_t size = 0;
+    void* data = tjson_encode(json, &size);
+    if (!data) return -1;
+
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s\n", filename);
+        s_free(data);
+        return -1;
+    }
+    size_t written = fwrite(data, 1, size, fp);
+    fclose(fp);
+    s_free(data);
+    return written == size ? 0 : -1;
+}
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct tjson_mapping_s {
+    void* data;
+    size_t size;
+    int mapped;
+};
+
+tjson_mapping_t* tjson_map_binary(const char* filename, tjson_view_t* root) {
+    if (!filename || !root) return NULL;
+    tjson_mapping_t* mapping = (tjson_mapping_t*)s_malloc(sizeof(tjson_mapping_t));
+    if (!mapping) return NULL;
+    mapping->data = NULL;
+    mapping->size = 0;
+    mapping->mapped = 0;
+
+#if !defined(_WIN32)
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && !fstat(fd, &st) && st.st_size > 0) {
+        void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            mapping->data = data;
+            mapping->size = (size_t)st.st_size;
+            mapping->mapped = 1;
         }
     }
-    return array;
+    if (fd >= 0) close(fd);
+#endif
+    if (!mapping->data) mapping->data = s_file_read_size(filename, &mapping->size);
+    if (!mapping->data || tjson_view_open(root, mapping->data, mapping->size)) {
+        tjson_unmap_binary(mapping);
+        return NULL;
+    }
+    return mapping;
 }
 
-tjson_t* s_parse_json_token(tjson_token_t *token) {
-    switch (token->type) {
-    case TJSON_TOKEN_LBRACE:
-        return s_parse_object();
-    case TJSON_TOKEN_LSQUAR:
-        return s_parse_array();
-    case TJSON_TOKEN_MINUS:
-    case TJSON_TOKEN_NUMBER:
-        return s_parse_number(token);
-    case TJSON_TOKEN_STRING:
-        return s_parse_string(token);
-    case TJSON_TOKEN_TRUE:
-        return tjson_create_bool(1);
-    case TJSON_TOKEN_FALSE:
-        return tjson_create_bool(0);
-    case TJSON_TOKEN_NULL:
-        return tjson_create_null();
-    case TJSON_TOKEN_ERROR:
-        {
-        s_error_at(token, token->start);
-        exit(1);
+void tjson_unmap_binary(tjson_mapping_t* mapping) {
+    if (!mapping) return;
+#if !defined(_WIN32)
+    if (mapping->mapped) munmap(mapping->data, mapping->size);
+    else
+#endif
+        s_free(mapping->data);
+    s_free(mapping);
+}
+
+tjson_t* tjson_open_binary(const char* filename) {
+    tjson_view_t root;
+    tjson_mapping_t* mapping = tjson_map_binary(filename, &root);
+    if (!mapping) return NULL;
+    tjson_t* json = tjson_view_decode(&root);
+    if (!json) fprintf(stderr, "[tinyjson]: corrupted binary image\n");
+    tjson_unmap_binary(mapping);
+    return json;
+}
+
+/*=============*
+ *    Print    *
+ *=============*/
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+    int failed;
+} tjson_writer_t;
+
+static char* s_writer_reserve(tjson_writer_t* w, size_t len) {
+    if (w->failed) return NULL;
+    if (w->size + len + 1 > w->capacity) {
+        size_t capacity = w->capacity ? w->capacity : 256;
+        while (w->size + len + 1 > capacity) capacity *= 2;
+        char* resized = (char*)s_realloc(w->data, capacity);
+        if (!resized) {
+            w->failed = 1;
+            return NULL;
         }
+        w->data = resized;
+        w->capacity = capacity;
     }
-    s_error_at(token, "unkown symbol");
-    exit(1);
-    return NULL;
+    return w->data + w->size;
 }
 
-tjson_t* s_parse_json(const char* json_str) {
-    s_init_scanner(json_str);
-    parser.hand_error = 0;
-    parser.panic_mode = 0;
-    tjson_token_t token = s_scan_token();
-    return s_parse_json_token(&token);
+static void s_write(tjson_writer_t* w, const char* str, size_t len) {
+    char* out = s_writer_reserve(w, len);
+    if (!out) return;
+    memcpy(out, str, len);
+    w->size += len;
+}
+
+static void s_write_number(tjson_writer_t* w, double value) {
+    char* out = s_writer_reserve(w, 32);
+    if (!out) return;
+    /* json has no nan or infinity */
+    if (value != value || value - value != 0) {
+        memcpy(out, "null", 4);
+        w->size += 4;
+        return;
+    }
+    /* integers, the common case, skip the printf/strtod round */
+    if (value > -1e9 && value < 1e9 && value == (double)(long)value) {
+        char digits[16];
+        char* start = out;
+        unsigned long n = value < 0 ? (unsigned long)-(long)value : (unsigned long)value;
+        int count = 0;
+        if (value < 0) *out++ = '-';
+        do digits[count++] = (char)('0' + n % 10); while (n /= 10);
+        while (count) *out++ = digits[--count];
+        w->size += out - start;
+        return;
+    }
+    /* shortest of the two precisions that reads back the same double */
+    int len = sprintf(out, "%.15g", value);
+    if (strtod(out, NULL) != value) len = sprintf(out, "%.17g", value);
+    w->size += len;
+}
+
+static int s_is_escape(char c) {
+    return c && strchr("\"\\/bfnrtu", c) != NULL;
+}
+
+static void s_write_string(tjson_writer_t* w, const char* str) {
+    int len = str ? s_str_len(str) : 0;
+    /* worst case every byte becomes a \u00XX */
+    char* out = s_writer_reserve(w, (size_t)len * 6 + 2);
+    if (!out) return;
+    char* start = out;
+    int i;
+    *out++ = '"';
+    for (i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)str[i];
+        if (c == '\\' && i + 1 < len && s_is_escape(str[i + 1])) {
+            *out++ = str[i++];
+            *out++ = str[i];
+        } else if (c == '"' || c == '\\') {
+            *out++ = '\\';
+            *out++ = (char)c;
+        } else if (c < 0x20) {
+            out += sprintf(out, "\\u%04x", c);
+        } else {
+            *out++ = (char)c;
+        }
+    }
+    *out++ = '"';
+    w->size += out - start;
+}
+
+static void s_write_json(tjson_writer_t* w, tjson_t* json) {
+    switch (json->type) {
+        case TJSON_NULL:
+            s_write(w, "null", 4);
+            break;
+        case TJSON_NUMBER:
+            s_write_number(w, json->number);
+            break;
+        case TJSON_BOOL:
+            if (json->boolean) s_write(w, "true", 4);
+            else s_write(w, "false", 5);
+            break;
+        case TJSON_STRING:
+            s_write_string(w, json->string);
+            break;
+        case TJSON_ARRAY:
+        case TJSON_OBJECT:
+            s_write(w, json->type == TJSON_ARRAY ? "[" : "{", 1);
+            /* packed arrays are written straight from their doubles */
+            if (json->flags & TJSON_FLAG_PACKED) {
+                const double* numbers = TJSON_PACKED_DATA(json->packed);
+                int i;
+                for (i = 0; i < json->packed->count; i++) {
+                    if (i) s_write(w, ",", 1);
+                    s_write_number(w, numbers[i]);
+                }
+            } else {
+                tjson_t* el = NULL;
+                tjson_foreach(el, json) {
+                    if (el != json->child) s_write(w, ",", 1);
+                    if (json->type == TJSON_OBJECT) {
+                        s_write_string(w, el->name);
+                        s_write(w, ":", 1);
+                    }
+                    s_write_json(w, el);
+                }
+            }
+            s_write(w, json->type == TJSON_ARRAY ? "]" : "}", 1);
+            break;
+    }
+}
+
+static char* s_print(tjson_t* json, size_t* size) {
+    tjson_writer_t w;
+    memset(&w, 0, sizeof(w));
+    s_write_json(&w, json);
+    if (w.failed || !s_writer_reserve(&w, 0)) {
+        s_free(w.data);
+        return NULL;
+    }
+    w.data[w.size] = '\0';
+    if (size) *size = w.size;
+    return w.data;
+}
+
+const char* tjson_print(tjson_t* json) {
+    if (!json) return NULL;
+    return s_print(json, NULL);
+}
+
+int tjson_save(tjson_t* json, const char* filename) {
+    size_t size = 0;
+    char* text = json ? s_print(json, &size) : NULL;
+    if (!text) return -1;
+
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s\n", filename);
+        s_free(text);
+        return -1;
+    }
+    size_t written = fwrite(text, 1, size, fp);
+    fclose(fp);
+    s_free(text);
+    return written == size ? 0 : -1;
 }
 
 /*==============*
  *    Utils     *
  *==============*/
 
-char* s_file_read(const char* filename) {
+char* s_file_read(const char* filename) { return s_file_read_size(filename, NULL); }
+
+char* s_file_read_size(const char* filename, size_t* out_size) {
     FILE* fp;
     fp = fopen(filename, "rb");
     if (!fp) {
@@ -904,7 +4072,7 @@ char* s_file_read(const char* filename) {
     size = ftell(fp);
     fseek(fp, 0, SEEK_SET);
 
-    char* buffer = (char*)malloc(size+1);
+    char* buffer = (char*)s_malloc(size+1);
     if (!buffer) {
         fclose(fp);
         fprintf(stderr, "Failed to alloc memory for %s buffer\n", filename);
@@ -914,13 +4082,14 @@ char* s_file_read(const char* filename) {
     bytes_read = fread(buffer, sizeof(char), size, fp);
     if (bytes_read < size) {
         fprintf(stderr, "Failed to read %s\n", filename);
-        free(buffer);
+        s_free(buffer);
         fclose(fp);
         return NULL;
     }
 
     buffer[bytes_read] = '\0';
     fclose(fp);
+    if (out_size) *out_size = bytes_read;
     return buffer;
 }
 
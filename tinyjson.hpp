@@ -0,0 +1,187 @@
+#ifndef _TINYJSON_HPP_
+#define _TINYJSON_HPP_
+
+/* C++17 wrapper over tinyjson.h. Only declarations are pulled in, compile
+ * the implementation once in a C file (see tinyjson.c). */
+
+#include "tinyjson.h"
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace tjson {
+
+enum class Type {
+    Null = TJSON_NULL,
+    Number = TJSON_NUMBER,
+    Bool = TJSON_BOOL,
+    String = TJSON_STRING,
+    Array = TJSON_ARRAY,
+    Object = TJSON_OBJECT
+};
+
+class Value;
+
+/* walks child/next, yields a Value per element */
+class Iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Value;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Value;
+
+    Iterator() noexcept = default;
+    explicit Iterator(tjson_t* json) noexcept : json_(json) {}
+
+    inline Value operator*() const noexcept;
+    Iterator& operator++() noexcept { json_ = tjson_get_next(json_); return *this; }
+    Iterator operator++(int) noexcept { Iterator it = *this; ++*this; return it; }
+
+    bool operator==(const Iterator& other) const noexcept { return json_ == other.json_; }
+    bool operator!=(const Iterator& other) const noexcept { return json_ != other.json_; }
+
+private:
+    tjson_t* json_ = nullptr;
+};
+
+/* Non-owning view of a node, as cheap to copy as the pointer it holds.
+ * A view of a missing node is empty: false in a condition, Type::Null,
+ * and every getter returns its zero value. */
+class Value {
+public:
+    Value() noexcept = default;
+    explicit Value(tjson_t* json) noexcept : json_(json) {}
+
+    explicit operator bool() const noexcept { return json_ != nullptr; }
+    tjson_t* handle() const noexcept { return json_; }
+
+    Type type() const noexcept { return json_ ? static_cast<Type>(tjson_get_type(json_)) : Type::Null; }
+    bool is_null() const noexcept { return type() == Type::Null; }
+    bool is_number() const noexcept { return type() == Type::Number; }
+    bool is_bool() const noexcept { return type() == Type::Bool; }
+    bool is_string() const noexcept { return type() == Type::String; }
+    bool is_array() const noexcept { return type() == Type::Array; }
+    bool is_object() const noexcept { return type() == Type::Object; }
+
+    std::string_view name() const noexcept {
+        const char* name = tjson_get_name(json_);
+        if (!name) return std::string_view();
+        return std::string_view(name, static_cast<std::size_t>(tjson_get_name_length(json_)));
+    }
+
+    /* get<double>(), get<int>(), get<bool>(), get<std::string_view>(),
+     * get<const char*>() or get<Value>(); other types don't compile */
+    template <typename T>
+    T get() const noexcept {
+        if constexpr (std::is_same_v<T, bool>) {
+            return is_bool() && tjson_to_bool(json_);
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            return is_number() ? static_cast<T>(tjson_to_number(json_)) : T();
+        } else if constexpr (std::is_same_v<T, std::string_view>) {
+            const char* string = tjson_to_string(json_);
+            if (!string) return std::string_view();
+            return std::string_view(string, static_cast<std::size_t>(tjson_to_string_length(json_)));
+        } else if constexpr (std::is_same_v<T, const char*>) {
+            return tjson_to_string(json_);
+        } else if constexpr (std::is_same_v<T, Value>) {
+            return *this;
+        } else {
+            static_assert(sizeof(T) == 0, "tjson::Value::get: unsupported type");
+        }
+    }
+
+    /* like get<T>() but falls back to 'opt' when the type doesn't match */
+    template <typename T>
+    T get_or(T opt) const noexcept {
+        if constexpr (std::is_same_v<T, bool>) {
+            return is_bool() ? get<T>() : opt;
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            return is_number() ? get<T>() : opt;
+        } else if constexpr (std::is_same_v<T, Value>) {
+            return json_ ? *this : opt;
+        } else {
+            return is_string() ? get<T>() : opt;
+        }
+    }
+
+    /* member lookup, the key must be NUL terminated for the C API */
+    Value operator[](const char* key) const noexcept { return Value(is_object() ? tjson_object_get(json_, key) : nullptr); }
+    Value operator[](const std::string& key) const noexcept { return (*this)[key.c_str()]; }
+    Value operator[](int index) const noexcept { return Value(is_array() ? tjson_array_get(json_, index) : nullptr); }
+
+    /* children of an array or object, empty for anything else */
+    Iterator begin() const noexcept {
+        return Iterator(is_array() || is_object() ? tjson_get_child(json_) : nullptr);
+    }
+    Iterator end() const noexcept { return Iterator(); }
+
+    bool operator==(const Value& other) const noexcept { return tjson_equal(json_, other.json_) != 0; }
+    bool operator!=(const Value& other) const noexcept { return !(*this == other); }
+
+private:
+    tjson_t* json_ = nullptr;
+};
+
+inline Value Iterator::operator*() const noexcept { return Value(json_); }
+
+/* Owns a tree and deletes it on destruction. Move only, use clone() for
+ * an explicit deep copy. */
+class Document {
+public:
+    Document() noexcept = default;
+    explicit Document(tjson_t* json) noexcept : json_(json) {}
+    ~Document() { tjson_delete(json_); }
+
+    Document(const Document&) = delete;
+    Document& operator=(const Document&) = delete;
+
+    Document(Document&& other) noexcept : json_(std::exchange(other.json_, nullptr)) {}
+    Document& operator=(Document&& other) noexcept {
+        if (this != &other) {
+            tjson_delete(json_);
+            json_ = std::exchange(other.json_, nullptr);
+        }
+        return *this;
+    }
+
+    static Document parse(const char* json_str) noexcept { return Document(tjson_parse(json_str)); }
+    static Document parse(const std::string& json_str) noexcept { return parse(json_str.c_str()); }
+    static Document open(const char* filename) noexcept { return Document(tjson_open(filename)); }
+
+    /* parse into the memory of the current tree, see tjson_reparse. False,
+     * with the document unchanged, for a null json_str or a shared tree;
+     * like tjson_parse, text that doesn't parse ends the process. */
+    bool reparse(const char* json_str) noexcept {
+        if (!json_str || tjson_is_frozen(json_)) return false;
+        json_ = tjson_reparse(json_, json_str);
+        return json_ != nullptr;
+    }
+
+    Document clone() const noexcept { return Document(tjson_clone(json_)); }
+
+    /* gives up ownership, the caller deletes the tree */
+    tjson_t* release() noexcept { return std::exchange(json_, nullptr); }
+
+    explicit operator bool() const noexcept { return json_ != nullptr; }
+    tjson_t* handle() const noexcept { return json_; }
+    Value root() const noexcept { return Value(json_); }
+
+    Value operator[](const char* key) const noexcept { return root()[key]; }
+    Value operator[](const std::string& key) const noexcept { return root()[key]; }
+    Value operator[](int index) const noexcept { return root()[index]; }
+
+    Iterator begin() const noexcept { return root().begin(); }
+    Iterator end() const noexcept { return root().end(); }
+
+private:
+    tjson_t* json_ = nullptr;
+};
+
+}
+
+#endif /* _TINYJSON_HPP_ */